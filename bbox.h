@@ -117,7 +117,7 @@ struct BBox
         }        
     }
 
-    virtual void move(const Vec3& v) 
+    void move(const Vec3& v) 
     {
         min += v;
         max += v;
@@ -287,6 +287,60 @@ struct BBox
     }
 
 
+    // Time of impact, as a fraction of displacement, of this box moving by displacement into b
+    // Returns TMAX if they don't meet within the move. hit_axis is the axis whose faces meet.
+    // Boxes only touching along an axis don't count as overlapping on it, so sliding along a
+    // wall doesn't stop the ship. Starting up to max_penetration deep still counts as a hit at 0,
+    // so a ship resting on a box after float rounding doesn't fall through it.
+    float calcSweptImpactTime(int& hit_axis, const BBox& b, const Vec3& displacement,
+                              const float max_penetration) const
+    {
+        float t_entry = -FLT_MAX, t_exit = FLT_MAX;
+        hit_axis = -1;
+        for(int i = 0; i < 3; i++)
+        {
+            float entry, exit;
+            if(displacement[i] > 0.0f)
+            {
+                entry = (b.min[i] - max[i]) / displacement[i];
+                exit = (b.max[i] - min[i]) / displacement[i];
+            }else if(displacement[i] < 0.0f)
+            {
+                entry = (b.max[i] - min[i]) / displacement[i];
+                exit = (b.min[i] - max[i]) / displacement[i];
+            }else
+            {
+                if(max[i] <= b.min[i] || min[i] >= b.max[i])
+                {
+                    return TMAX;
+                }
+                continue;
+            }
+            if(entry > t_entry)
+            {
+                t_entry = entry;
+                hit_axis = i;
+            }
+            if(exit < t_exit)
+            {
+                t_exit = exit;
+            }
+        }
+        if(hit_axis == -1 || t_entry >= t_exit || t_entry > 1.0f)
+        {
+            return TMAX;
+        }
+        if(t_entry < 0.0f)
+        {
+            if(-t_entry * fabs(displacement[hit_axis]) > max_penetration)
+            {
+                return TMAX;
+            }
+            t_entry = 0.0f;
+        }
+        return t_entry;
+    }
+
     Vec3 getCenter()
     {
         return min + (max - min) * 0.5f;
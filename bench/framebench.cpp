@@ -0,0 +1,396 @@
+/*
+  Frame benchmark
+  Renders play mode and the four view editor along a scripted camera path in an
+  offscreen EGL context, so it runs on machines without a display or GPU, e.g.
+  with Mesa's llvmpipe. Prints CPU frame time percentiles, draw call counts and
+  the visible and culled counts of each view of each mode as JSON.
+  Build with "make framebench" and run from the repo root:
+    ./framebench [track_file] [num_frames] [json_file]
+  Without a track file it runs on a generated 16 lane track, pass "generated" to
+  get it along with the other arguments. The model loader logs to stdout, so pass
+  a json_file to get the results alone.
+  With LIBGL_ALWAYS_SOFTWARE=1 Mesa picks llvmpipe even when a GPU is present.
+ */
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include "../track.h"
+#include "../ship.h"
+#include "../camera.h"
+#include "../trackrenderer.h"
+#include "../trackmesher.h"
+#include "../frameuniforms.h"
+#include "../renderqueue.h"
+#include "../glstate.h"
+#include "../streambuffer.h"
+#include "../globaldata.h"
+#include "../input.h"
+#include "../editor.h"
+
+GlobalData g;
+Input g_input;
+ShaderRegistry g_shaders;
+GLState g_gl_state;
+StreamBuffer g_stream_buffer;
+
+// editor.h expects these from main.cpp. The camera follows the script instead of
+// the keyboard, and with no clicks nothing asks for window coordinates.
+void moveCamera(Camera&, const Input&, const float)
+{
+}
+
+void getNormalizedWindowCoord(float& x, float& y, const unsigned int, const unsigned int)
+{
+    x = y = 0.0f;
+}
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+// Same as main.cpp
+const int WINDOW_WIDTH = 1600;
+const int WINDOW_HEIGHT = 900;
+const float FOV = 90.0f;
+const float FRAME_DT = 1.0f / 60.0f;
+// Frames drawn before timing starts, they compile shaders and build meshes
+const int NUM_WARMUP_FRAMES = 10;
+// Play mode culls the chunks of the track mesh in its one view
+static const char* const PLAY_VIEW_NAMES[1] = {"track_chunks"};
+
+struct FrameSample
+{
+    double cpu_ms;      // Until every GL call of the frame was made
+    double frame_ms;    // Until glFinish returned, which includes the rendering with a software rasterizer
+    int draws;
+    GLStateStats state;
+    // Of each view of the mode that culls, see printMode
+    CullStats cull_stats[NUM_EDITOR_VIEWS];
+};
+
+static double msBetween(const BenchClock::time_point& start, const BenchClock::time_point& end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Returns false if no context could be made, pbuffers give it a default framebuffer
+static bool initContext(const int width, const int height)
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay)
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if(display == EGL_NO_DISPLAY)
+    {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major, minor;
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        fprintf(stderr, "No EGL display\n");
+        return false;
+    }
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint num_configs;
+    if(!eglChooseConfig(display, config_attribs, &config, 1, &num_configs) || num_configs == 0)
+    {
+        fprintf(stderr, "No EGL config with a pbuffer and desktop GL\n");
+        return false;
+    }
+    const EGLint surface_attribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attribs);
+    eglBindAPI(EGL_OPENGL_API);
+    // Same context as initWindow asks GLFW for
+    const EGLint context_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if(surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+    {
+        fprintf(stderr, "Can't make a GL 3.3 core context current, EGL error 0x%x\n", eglGetError());
+        return false;
+    }
+    glewExperimental = GL_TRUE;
+    GLenum glew_error = glewInit();
+    // GLEW built for GLX loads the GL functions and then fails to find an X display
+    if(glew_error != GLEW_OK && glew_error != GLEW_ERROR_NO_GLX_DISPLAY)
+    {
+        fprintf(stderr, "glewInit failed: %s\n", glewGetErrorString(glew_error));
+        return false;
+    }
+    return true;
+}
+
+// Flies down the track from its far +z end towards -z, weaving and bobbing so the
+// visible set keeps changing, looking ahead and slightly down
+static void placeCamera(Camera& camera, const BBox& bounds, const float t)
+{
+    Vec3 center = (bounds.min + bounds.max) * 0.5f;
+    Vec3 size = bounds.max - bounds.min;
+    float z = bounds.max[2] - size[2] * t;
+    float x = center[0] + 0.3f * size[0] * sinf(t * 6.2832f * 3.0f);
+    float y = bounds.max[1] + 2.5f + 1.5f * sinf(t * 6.2832f * 5.0f);
+    float heading = 20.0f * cosf(t * 6.2832f * 3.0f);
+    camera.setPosAndOrientation(Vec3(x, y, z), Vec3(heading, -15.0f, 0.0f));
+}
+
+// Same layout as headless: 16 lanes wide along -z, with every 7th box raised a level
+// Lanes alternate between two colors, so merging has something to keep apart
+static void makeTrack(Track& track, const int num_boxes)
+{
+    const int num_lanes = 16;
+    for(int i = 0; i < num_boxes; i++)
+    {
+        float x = (float)(i % num_lanes) - num_lanes / 2;
+        float z = -(float)(i / num_lanes);
+        float y = (i % 7 == 0) ? 1.0f : 0.0f;
+        Vec3 color = (i % num_lanes) / 4 % 2 ? Vec3(0.8f, 0.3f, 0.2f) : Vec3(0.7f, 0.7f, 0.7f);
+        track.addBox(Box(Vec3(x, y - 1.0f, z - 1.0f), Vec3(x + 1.0f, y, z), color));
+    }
+}
+
+static BBox calcTrackBounds(const Track& track)
+{
+    BBox bounds;
+    bounds.min = Vec3(0.0f, 0.0f, 0.0f);
+    bounds.max = Vec3(0.0f, 0.0f, 0.0f);
+    for(int i = 0; i < track.getNumBoxes(); i++)
+    {
+        const Box& box = track.getBoxAtIndex(i);
+        for(int j = 0; j < 3; j++)
+        {
+            bounds.min[j] = i == 0 ? box.min[j] : std::min(bounds.min[j], box.min[j]);
+            bounds.max[j] = i == 0 ? box.max[j] : std::max(bounds.max[j], box.max[j]);
+        }
+    }
+    return bounds;
+}
+
+static double percentile(std::vector<double> values, const double p)
+{
+    if(values.empty())
+    {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+static void printTimes(FILE* out, const char* name, const std::vector<FrameSample>& samples, const bool frame_time)
+{
+    std::vector<double> times;
+    double sum = 0.0;
+    for(int i = 0; i < samples.size(); i++)
+    {
+        times.push_back(frame_time ? samples[i].frame_ms : samples[i].cpu_ms);
+        sum += times.back();
+    }
+    fprintf(out, "      \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n", name,
+           times.empty() ? 0.0 : sum / times.size(), percentile(times, 0.5), percentile(times, 0.9),
+           percentile(times, 0.99), percentile(times, 1.0));
+}
+
+// Mean visible and culled counts per frame of each of the num_views views
+static void printCulling(FILE* out, const std::vector<FrameSample>& samples, const char* const* view_names,
+                         const int num_views)
+{
+    double n = samples.empty() ? 1.0 : samples.size();
+    fprintf(out, "      \"culling\": {");
+    for(int view = 0; view < num_views; view++)
+    {
+        double visible = 0.0, culled = 0.0;
+        for(int i = 0; i < samples.size(); i++)
+        {
+            visible += samples[i].cull_stats[view].num_visible;
+            culled += samples[i].cull_stats[view].num_culled;
+        }
+        fprintf(out, "%s\"%s\": {\"visible\": %.2f, \"culled\": %.2f}", view == 0 ? "" : ", ", view_names[view],
+                visible / n, culled / n);
+    }
+    fprintf(out, "},\n");
+}
+
+// view_names names the first num_views cull_stats of the samples
+static void printMode(FILE* out, const char* mode, const std::vector<FrameSample>& samples,
+                      const char* const* view_names, const int num_views, const bool last)
+{
+    double draws = 0.0, issued = 0.0, elided = 0.0;
+    for(int i = 0; i < samples.size(); i++)
+    {
+        draws += samples[i].draws;
+        issued += samples[i].state.issued;
+        elided += samples[i].state.elided;
+    }
+    double n = samples.empty() ? 1.0 : samples.size();
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"mode\": \"%s\",\n", mode);
+    fprintf(out, "      \"frames\": %d,\n", (int)samples.size());
+    printTimes(out, "cpu_ms", samples, false);
+    printTimes(out, "frame_ms", samples, true);
+    printCulling(out, samples, view_names, num_views);
+    fprintf(out, "      \"draw_calls_per_frame\": %.2f,\n", draws / n);
+    fprintf(out, "      \"state_calls_issued_per_frame\": %.2f,\n", issued / n);
+    fprintf(out, "      \"state_calls_elided_per_frame\": %.2f\n", elided / n);
+    fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+// Like the main loop, after the frame's draws
+static FrameSample endFrame(const BenchClock::time_point& start)
+{
+    FrameSample sample;
+    memset(sample.cull_stats, 0, sizeof(sample.cull_stats));
+    g_stream_buffer.endFrame();
+    g_gl_state.endFrame();
+    BenchClock::time_point submitted = BenchClock::now();
+    glFinish();
+    sample.cpu_ms = msBetween(start, submitted);
+    sample.frame_ms = msBetween(start, BenchClock::now());
+    sample.state = g_gl_state.getLastFrameStats();
+    sample.draws = sample.state.draws;
+    return sample;
+}
+
+int main(int argc, char** argv)
+{
+    const char* track_file_name = argc > 1 ? argv[1] : "generated";
+    int num_frames = argc > 2 ? atoi(argv[2]) : 600;
+    if(num_frames <= 0 || argc > 4)
+    {
+        fprintf(stderr, "Usage: %s [track_file] [num_frames] [json_file]\n", argv[0]);
+        return 1;
+    }
+    FILE* out = stdout;
+    if(argc > 3)
+    {
+        out = fopen(argv[3], "w");
+        if(!out)
+        {
+            fprintf(stderr, "Can't open %s\n", argv[3]);
+            return 1;
+        }
+    }
+    g.initGlobalData();
+    g.window_width = WINDOW_WIDTH;
+    g.window_height = WINDOW_HEIGHT;
+    g.dt = FRAME_DT;
+    if(!initContext(WINDOW_WIDTH, WINDOW_HEIGHT))
+    {
+        return 1;
+    }
+
+    float aspect_ratio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+    Mat4 proj_transform(Mat4::makePerspective(FOV, aspect_ratio, 0.001f, 20.0f));
+    PerspectiveCamera camera(Vec3(0.0f, 0.0f, -1.0f), Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 1.0f, 4.0f), FOV,
+                             aspect_ratio);
+    Ship ship;
+    ship.setStaticUniforms();
+    ship.move(Vec3(0.0f, 2.0f, 0.0f));
+    FrameUniforms frame_uniforms;
+    frame_uniforms.setDirLight(normalize(Vec3(0.7f, 2.0f, 1.0f)));
+    RenderQueue render_queue;
+    Track track;
+    if(argc > 1 && strcmp(track_file_name, "generated") != 0)
+    {
+        track.readFromFile(track_file_name);
+    }else
+    {
+        makeTrack(track, 20000);
+    }
+    if(track.getNumBoxes() == 0)
+    {
+        fprintf(stderr, "No boxes read from %s\n", track_file_name);
+        return 1;
+    }
+    TrackRenderer track_renderer;
+    TrackMesh track_mesh;
+    BBox bounds = calcTrackBounds(track);
+    glEnable(GL_DEPTH_TEST);
+    g_gl_state.invalidate();
+    glClearColor(0.1f, 0.2f, 0.2f, 1.0f);
+
+    // Play mode, the draws of gameModeFrame with the camera on the script
+    std::vector<FrameSample> play_samples;
+    for(int i = 0; i < NUM_WARMUP_FRAMES + num_frames; i++)
+    {
+        BenchClock::time_point start = BenchClock::now();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        placeCamera(camera, bounds, (float)i / (NUM_WARMUP_FRAMES + num_frames));
+        frame_uniforms.setCamera(camera.getViewTransform(), proj_transform, camera.getPosition());
+        frame_uniforms.upload();
+        ship.updateDynamicUniforms();
+        track_mesh.update(track);
+        render_queue.begin(camera.getPosition());
+        ship.submit(render_queue);
+        track_mesh.submit(render_queue, camera.calcFrustum(proj_transform));
+        render_queue.execute();
+        FrameSample sample = endFrame(start);
+        sample.cull_stats[0] = track_mesh.getCullStats();
+        if(i >= NUM_WARMUP_FRAMES)
+        {
+            play_samples.push_back(sample);
+        }
+    }
+
+    // Four view editor, every frame a full Editor::frame with no input
+    g.game_mode = EDITOR;
+    g.editor_multi_view = true;
+    std::vector<FrameSample> editor_samples;
+    {
+        Editor editor(track, track_renderer, ship, frame_uniforms, aspect_ratio, FOV, proj_transform);
+        for(int i = 0; i < NUM_WARMUP_FRAMES + num_frames; i++)
+        {
+            BenchClock::time_point start = BenchClock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            placeCamera(editor.getPerspectiveCamera(), bounds, (float)i / (NUM_WARMUP_FRAMES + num_frames));
+            editor.frame();
+            FrameSample sample = endFrame(start);
+            for(int view = 0; view < NUM_EDITOR_VIEWS; view++)
+            {
+                sample.cull_stats[view] = editor.getCullStats((EditorView)view);
+            }
+            if(i >= NUM_WARMUP_FRAMES)
+            {
+                editor_samples.push_back(sample);
+            }
+        }
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"track\": \"%s\",\n", track_file_name);
+    fprintf(out, "  \"boxes\": %d,\n", track.getNumBoxes());
+    fprintf(out, "  \"width\": %d,\n", WINDOW_WIDTH);
+    fprintf(out, "  \"height\": %d,\n", WINDOW_HEIGHT);
+    fprintf(out, "  \"renderer\": \"%s\",\n", (const char*)glGetString(GL_RENDERER));
+    fprintf(out, "  \"modes\": [\n");
+    printMode(out, "play", play_samples, PLAY_VIEW_NAMES, 1, false);
+    printMode(out, "editor_four_view", editor_samples, EDITOR_VIEW_NAMES, NUM_EDITOR_VIEWS, true);
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+    if(out != stdout)
+    {
+        fclose(out);
+    }
+
+    g_stream_buffer.destroy();
+    g_shaders.deleteAll();
+    return 0;
+}
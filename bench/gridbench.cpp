@@ -0,0 +1,137 @@
+/*
+  Collision broadphase benchmark
+  Builds tracks of 1k to 1M unit boxes and times ship sized bbox queries against
+  SpatialGrid, against a linear scan like the old Track::bboxCollideWithTrack, and
+  against the BoxStore scan with the SIMD and the scalar kernel.
+  Build with "make gridbench" and run from the repo root.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include "../spatialgrid.h"
+#include "../boxstore.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Lay boxes out like a track: 16 lanes wide along -z, with every 7th box raised a level
+static void makeTrack(std::vector<BBox>& boxes, const int num_boxes)
+{
+    const int num_lanes = 16;
+    boxes.clear();
+    boxes.reserve(num_boxes);
+    for(int i = 0; i < num_boxes; i++)
+    {
+        float x = (float)(i % num_lanes) - num_lanes / 2;
+        float z = -(float)(i / num_lanes);
+        float y = (i % 7 == 0) ? 1.0f : 0.0f;
+        boxes.push_back(BBox(Vec3(x, y - 1.0f, z - 1.0f), Vec3(x + 1.0f, y, z)));
+    }
+}
+
+static void makeQueries(std::vector<BBox>& queries, const int num_boxes, const int num_queries)
+{
+    const int num_rows = num_boxes / 16;
+    queries.clear();
+    for(int i = 0; i < num_queries; i++)
+    {
+        float x = (float)(rand() % 1600) / 100.0f - 8.0f;
+        float z = -(float)(rand() % (num_rows * 10)) / 10.0f;
+        float y = (float)(rand() % 100) / 100.0f - 0.5f;
+        Vec3 min(x, y, z);
+        queries.push_back(BBox(min, min + Vec3(1.2f, 0.5f, 2.0f)));
+    }
+}
+
+static int linearQuery(int* results, const int max_results, const std::vector<BBox>& boxes, const BBox& bbox)
+{
+    int count = 0;
+    for(int i = 0; i < boxes.size() && count < max_results; i++)
+    {
+        if(bbox.bboxIntersect(boxes[i]))
+        {
+            results[count++] = i;
+        }
+    }
+    return count;
+}
+
+int main()
+{
+    const int box_counts[] = {1000, 10000, 100000, 1000000};
+    const int num_queries = 100000;
+    int results[24];
+    std::vector<BBox> boxes, queries;
+
+    printf("%10s %12s %14s %14s %14s %14s %10s\n", "boxes", "build (ms)", "grid (ns/q)", "linear (ns/q)",
+           "simd (ns/q)", "scalar (ns/q)", "hits/q");
+    for(int c = 0; c < sizeof(box_counts) / sizeof(box_counts[0]); c++)
+    {
+        const int num_boxes = box_counts[c];
+        makeTrack(boxes, num_boxes);
+        makeQueries(queries, num_boxes, num_queries);
+
+        BenchClock::time_point start = BenchClock::now();
+        SpatialGrid grid;
+        for(int i = 0; i < num_boxes; i++)
+        {
+            grid.insert(i, boxes[i]);
+        }
+        double build_time = secondsSince(start);
+
+        long long grid_hits = 0;
+        start = BenchClock::now();
+        for(int i = 0; i < num_queries; i++)
+        {
+            grid_hits += grid.query(results, 24, queries[i]);
+        }
+        double grid_time = secondsSince(start);
+
+        // The linear scan gets fewer queries so the 1M row finishes in reasonable time
+        const int num_linear_queries = num_queries * 1000 / num_boxes;
+        long long linear_hits = 0;
+        start = BenchClock::now();
+        for(int i = 0; i < num_linear_queries; i++)
+        {
+            linear_hits += linearQuery(results, 24, boxes, queries[i]);
+        }
+        double linear_time = secondsSince(start);
+
+        BoxStore store;
+        store.reserve(num_boxes);
+        for(int i = 0; i < num_boxes; i++)
+        {
+            store.push(boxes[i]);
+        }
+        long long simd_hits = 0;
+        start = BenchClock::now();
+        for(int i = 0; i < num_linear_queries; i++)
+        {
+            simd_hits += store.overlapQuery(results, 24, queries[i]);
+        }
+        double simd_time = secondsSince(start);
+
+        long long scalar_hits = 0;
+        start = BenchClock::now();
+        for(int i = 0; i < num_linear_queries; i++)
+        {
+            scalar_hits += store.overlapQueryScalar(results, 24, queries[i]);
+        }
+        double scalar_time = secondsSince(start);
+        if(simd_hits != linear_hits || scalar_hits != linear_hits)
+        {
+            printf("BoxStore hits differ from the linear scan\n");
+        }
+
+        printf("%10d %12.2f %14.1f %14.1f %14.1f %14.1f %10.2f\n", num_boxes, build_time * 1e3,
+               grid_time / num_queries * 1e9, linear_time / num_linear_queries * 1e9,
+               simd_time / num_linear_queries * 1e9, scalar_time / num_linear_queries * 1e9,
+               (double)grid_hits / num_queries);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+  Headless simulation driver
+  Steps ShipSim over a track with scripted input for a number of ticks, without a
+  window or GL context, and reports ticks per second.
+  Build with "make headless" and run from the repo root:
+    ./headless [track_file] [num_ticks]
+  Without a track file it runs on a generated 16 lane track.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include "../shipsim.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+const float TICK_DT = 1.0f / 60.0f;
+// Below this the ship has fallen off the track and is put back on it, like pressing r
+const float FALL_RESET_Y = -50.0f;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Same layout as gridbench: 16 lanes wide along -z, with every 7th box raised a level
+static void makeTrack(Track& track, const int num_boxes)
+{
+    const int num_lanes = 16;
+    for(int i = 0; i < num_boxes; i++)
+    {
+        float x = (float)(i % num_lanes) - num_lanes / 2;
+        float z = -(float)(i / num_lanes);
+        float y = (i % 7 == 0) ? 1.0f : 0.0f;
+        track.addBox(Box(Vec3(x, y - 1.0f, z - 1.0f), Vec3(x + 1.0f, y, z)));
+    }
+}
+
+// Always forward, weaving left and right, jumping every couple of seconds
+// Like calcShipAccelState in main.cpp, the ship falls whenever it isn't asked to jump
+static void scriptedInput(int accel_states[3], const int tick)
+{
+    accel_states[2] = -1;
+    int weave = (tick / 90) % 4;
+    accel_states[0] = weave == 1 ? -1 : (weave == 3 ? 1 : 0);
+    accel_states[1] = (tick % 120) == 0 ? 1 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    int num_ticks = 1000000;
+    Track track;
+    if(argc > 1)
+    {
+        track.readFromFile(argv[1]);
+    }else
+    {
+        makeTrack(track, 100000);
+    }
+    if(argc > 2)
+    {
+        num_ticks = atoi(argv[2]);
+    }
+    if(track.getNumBoxes() == 0)
+    {
+        fprintf(stderr, "No boxes in track\n");
+        return 1;
+    }
+
+    ShipSim ship(ShipSim::loadModelBBox("models/Ship2.obj"));
+    ship.move(Vec3(0.0f, 2.0f, 0.0f));
+    int num_resets = 0, num_grounded = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for(int tick = 0; tick < num_ticks; tick++)
+    {
+        int accel_states[3];
+        scriptedInput(accel_states, tick);
+        ship.calcVelocity(accel_states, TICK_DT);
+        ship.updatePosAndVelocity(TICK_DT, track);
+        num_grounded += ship.grounded ? 1 : 0;
+        if(ship.getPos()[1] < FALL_RESET_Y)
+        {
+            ship.resetPosition();
+            ship.move(Vec3(0.0f, 2.0f, 0.0f));
+            ship.velocity = Vec3();
+            num_resets++;
+        }
+    }
+    double seconds = secondsSince(start);
+
+    Vec3 pos = ship.getPos();
+    printf("boxes %d ticks %d time %.3f s\n", track.getNumBoxes(), num_ticks, seconds);
+    printf("ticks per second %.0f (%.3f us per tick)\n", num_ticks / seconds, seconds * 1e6 / num_ticks);
+    printf("grounded ticks %d resets %d final position %.2f %.2f %.2f\n", num_grounded, num_resets,
+           pos[0], pos[1], pos[2]);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+  OBJ loading benchmark
+  Writes grid meshes of 20k to 2M triangles with positions, texcoords and normals,
+  then times loadOBJ on each and prints the throughput in MB/s of file and
+  triangles per second, with the number of heap allocations of the loader's
+  DBuffers and their peak size. Pass OBJ files to time those instead.
+  Build with "make objbench" and run from the repo root:
+    ./objbench [file.obj ...]
+  The generated files are written to the current directory and removed afterwards.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#define OBJ_LOADER_IMPLEMENTATION
+#include "../objloader/objloader.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static const int NUM_RUNS = 3;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// A size x size grid of quads, every other one split into two triangles
+static bool writeGridOBJ(const char* file_name, const int size)
+{
+    FILE* file = fopen(file_name, "w");
+    if(!file)
+    {
+        return false;
+    }
+    fprintf(file, "# objbench grid %dx%d\ng grid\n", size, size);
+    for(int y = 0; y <= size; y++)
+    {
+        for(int x = 0; x <= size; x++)
+        {
+            float height = 0.25f * sinf(x * 0.1f) * cosf(y * 0.1f);
+            fprintf(file, "v %f %f %f\n", x * 0.01f, height, y * -0.01f);
+            fprintf(file, "vt %f %f\n", (float)x / size, (float)y / size);
+            fprintf(file, "vn %f %f %f\n", -0.025f * cosf(x * 0.1f), 1.0f, 0.025f * sinf(y * 0.1f));
+        }
+    }
+    for(int y = 0; y < size; y++)
+    {
+        for(int x = 0; x < size; x++)
+        {
+            int i0 = y * (size + 1) + x + 1;
+            int i1 = i0 + 1;
+            int i2 = i0 + size + 2;
+            int i3 = i0 + size + 1;
+            if((x + y) % 2 == 0)
+            {
+                fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", i0, i0, i0, i1, i1, i1, i2, i2, i2, i3,
+                        i3, i3);
+            }else
+            {
+                fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\nf %d/%d/%d %d/%d/%d %d/%d/%d\n", i0, i0, i0, i1, i1,
+                        i1, i2, i2, i2, i0, i0, i0, i2, i2, i2, i3, i3, i3);
+            }
+        }
+    }
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+static long getFileSize(const char* file_name)
+{
+    FILE* file = fopen(file_name, "rb");
+    if(!file)
+    {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// Best of NUM_RUNS, the first run also warms the page cache
+static bool timeLoad(const char* file_name)
+{
+    long file_size = getFileSize(file_name);
+    if(file_size < 0)
+    {
+        fprintf(stderr, "Can't open %s\n", file_name);
+        return false;
+    }
+    double best = 0.0;
+    int num_triangles = 0;
+    DBufferStats stats;
+    for(int run = 0; run < NUM_RUNS; run++)
+    {
+        OBJShape* shapes;
+        OBJMaterial* materials;
+        int num_shapes, num_materials;
+        DBuffer_reset_stats();
+        BenchClock::time_point start = BenchClock::now();
+        if(!loadOBJ(&shapes, &materials, &num_shapes, &num_materials, file_name))
+        {
+            return false;
+        }
+        double seconds = secondsSince(start);
+        stats = g_dbuffer_stats;
+        best = run == 0 || seconds < best ? seconds : best;
+        num_triangles = 0;
+        for(int i = 0; i < num_shapes; i++)
+        {
+            num_triangles += shapes[i].num_indices / 3;
+            OBJShape_destroy(&(shapes[i]));
+        }
+        free(shapes);
+        free(materials);
+    }
+    printf("%-24s %8.2f MB %9d tris %8.3f s %8.1f MB/s %6.2f Mtris/s %9lld allocs %8.1f MB peak\n", file_name,
+           file_size / 1.0e6, num_triangles, best, file_size / 1.0e6 / best, num_triangles / 1.0e6 / best,
+           stats.num_allocs, stats.peak_bytes / 1.0e6);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc > 1)
+    {
+        for(int i = 1; i < argc; i++)
+        {
+            timeLoad(argv[i]);
+        }
+        return 0;
+    }
+    const int sizes[] = {100, 316, 1000};
+    for(int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        char file_name[64];
+        snprintf(file_name, sizeof(file_name), "objbench_%d.obj", sizes[i]);
+        if(!writeGridOBJ(file_name, sizes[i]))
+        {
+            fprintf(stderr, "Can't write %s\n", file_name);
+            return 1;
+        }
+        bool ok = timeLoad(file_name);
+        remove(file_name);
+        if(!ok)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*
+  Number parsing benchmark
+  Times the float parsing of the OBJ loader on the v, vt and vn lines of an OBJ
+  file, against strtod and atof on the same numbers, and checks that every value
+  matches strtof to the bit. Without a file it generates 1M lines of each in
+  memory, printed with %f and %.9g like exporters do.
+  Build with "make parsebench" and run:
+    ./parsebench [file.obj]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "../mappedfile.h"
+#define OBJ_LOADER_IMPLEMENTATION
+#include "../objloader/objloader.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static const int NUM_RUNS = 5;
+static const int NUM_GENERATED_LINES = 1000000;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// The number fields of the vertex lines, each as its own '\0' terminated string
+// so all three parsers get the same input and atof can run on it
+struct NumberText
+{
+    std::vector<char> text;
+    std::vector<int> starts;
+    size_t num_bytes;
+};
+
+static void addVertexLine(NumberText& numbers, const char* line, const char* end)
+{
+    const char* ptr = line;
+    OBJSkipToken(&ptr, end);
+    while(true)
+    {
+        OBJSkipSpace(&ptr, end);
+        if(ptr == end)
+        {
+            break;
+        }
+        const char* token = ptr;
+        OBJSkipToken(&ptr, end);
+        numbers.starts.push_back(numbers.text.size());
+        numbers.text.insert(numbers.text.end(), token, ptr);
+        numbers.text.push_back('\0');
+        numbers.num_bytes += ptr - token;
+    }
+}
+
+static bool readNumbers(NumberText& numbers, const char* file_name)
+{
+    MappedFile file;
+    if(!file.open(file_name))
+    {
+        fprintf(stderr, "Can't open %s\n", file_name);
+        return false;
+    }
+    const char* ptr = file.getData();
+    const char* end = ptr + file.getSize();
+    while(ptr < end)
+    {
+        const char* line_ptr = ptr;
+        const char* line_end;
+        ptr = OBJNextLine(ptr, end, &line_end);
+        OBJSkipSpace(&line_ptr, line_end);
+        if(OBJIsKeyword(line_ptr, line_end, "v", 1) || OBJIsKeyword(line_ptr, line_end, "vt", 2) ||
+           OBJIsKeyword(line_ptr, line_end, "vn", 2))
+        {
+            addVertexLine(numbers, line_ptr, line_end);
+        }
+    }
+    return true;
+}
+
+static void generateNumbers(NumberText& numbers)
+{
+    srand(1);
+    char line[256];
+    for(int i = 0; i < NUM_GENERATED_LINES; i++)
+    {
+        float x = (rand() / (float)RAND_MAX - 0.5f) * 200.0f;
+        float y = (rand() / (float)RAND_MAX - 0.5f) * 2.0f;
+        float z = (rand() / (float)RAND_MAX - 0.5f) * 0.02f;
+        int length = i % 2 == 0 ? snprintf(line, sizeof(line), "v %f %f %f", x, y, z) :
+                                  snprintf(line, sizeof(line), "vn %.9g %.9g %.9g", x, y, z);
+        addVertexLine(numbers, line, line + length);
+        length = snprintf(line, sizeof(line), "vt %f %f", rand() / (float)RAND_MAX, rand() / (float)RAND_MAX);
+        addVertexLine(numbers, line, line + length);
+    }
+}
+
+enum Parser
+{
+    PARSER_OBJ,
+    PARSER_STRTOD,
+    PARSER_ATOF
+};
+
+// Best of NUM_RUNS, returns the sum so the parsing can't be optimized away
+static double timeParser(const NumberText& numbers, const Parser parser, const char* name)
+{
+    double best = 0.0;
+    double sum = 0.0;
+    const char* text = &(numbers.text[0]);
+    for(int run = 0; run < NUM_RUNS; run++)
+    {
+        sum = 0.0;
+        BenchClock::time_point start = BenchClock::now();
+        for(int i = 0; i < numbers.starts.size(); i++)
+        {
+            const char* number = text + numbers.starts[i];
+            if(parser == PARSER_OBJ)
+            {
+                size_t length = (i + 1 < numbers.starts.size() ? numbers.starts[i + 1] : numbers.text.size()) -
+                                numbers.starts[i] - 1;
+                sum += OBJParseFloat(&number, number + length);
+            }else if(parser == PARSER_STRTOD)
+            {
+                sum += (float)strtod(number, NULL);
+            }else
+            {
+                sum += (float)atof(number);
+            }
+        }
+        double seconds = secondsSince(start);
+        best = run == 0 || seconds < best ? seconds : best;
+    }
+    printf("%-16s %10.3f ms %10.1f MB/s %10.1f Mfloats/s\n", name, best * 1000.0, numbers.num_bytes / 1.0e6 / best,
+           numbers.starts.size() / 1.0e6 / best);
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    NumberText numbers;
+    numbers.num_bytes = 0;
+    if(argc > 1)
+    {
+        if(!readNumbers(numbers, argv[1]))
+        {
+            return 1;
+        }
+    }else
+    {
+        generateNumbers(numbers);
+    }
+    if(numbers.starts.empty())
+    {
+        fprintf(stderr, "No vertex lines in %s\n", argv[1]);
+        return 1;
+    }
+    printf("%d numbers, %.2f MB of digits\n", (int)numbers.starts.size(), numbers.num_bytes / 1.0e6);
+
+    int num_mismatches = 0;
+    for(int i = 0; i < numbers.starts.size(); i++)
+    {
+        const char* number = &(numbers.text[numbers.starts[i]]);
+        const char* ptr = number;
+        float parsed = OBJParseFloat(&ptr, number + strlen(number));
+        float expected = strtof(number, NULL);
+        if(memcmp(&parsed, &expected, sizeof(float)) != 0 && num_mismatches++ < 10)
+        {
+            printf("Mismatch for %s: %a instead of %a\n", number, parsed, expected);
+        }
+    }
+
+    double sum = timeParser(numbers, PARSER_OBJ, "OBJParseFloat");
+    sum += timeParser(numbers, PARSER_STRTOD, "strtod");
+    sum += timeParser(numbers, PARSER_ATOF, "atof");
+    printf("%d mismatches against strtof (checksum %g)\n", num_mismatches, sum);
+    return num_mismatches == 0 ? 0 : 1;
+}
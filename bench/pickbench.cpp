@@ -0,0 +1,114 @@
+/*
+  Editor picking benchmark
+  Times nearest hit ray queries through the BVH against the linear scan the old
+  Track::rayIntersectTrack did, for tracks of 1k to 1M boxes, and checks both agree.
+  Build with "make pickbench" and run from the repo root.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include "../bvh.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Same layout as gridbench: 16 lanes along -z, every 7th box raised a level
+static void makeTrack(std::vector<BBox>& boxes, const int num_boxes)
+{
+    const int num_lanes = 16;
+    boxes.clear();
+    boxes.reserve(num_boxes);
+    for(int i = 0; i < num_boxes; i++)
+    {
+        float x = (float)(i % num_lanes) - num_lanes / 2;
+        float z = -(float)(i / num_lanes);
+        float y = (i % 7 == 0) ? 1.0f : 0.0f;
+        boxes.push_back(BBox(Vec3(x, y - 1.0f, z - 1.0f), Vec3(x + 1.0f, y, z)));
+    }
+}
+
+// Rays from an editor camera hovering over the track, looking forward and down
+static void makeRays(std::vector<Ray>& rays, const int num_boxes, const int num_rays)
+{
+    const int num_rows = num_boxes / 16;
+    rays.clear();
+    for(int i = 0; i < num_rays; i++)
+    {
+        Ray ray;
+        ray.origin = Vec3((float)(rand() % 1600) / 100.0f - 8.0f, 4.0f, -(float)(rand() % num_rows));
+        ray.dir = normalize(Vec3((float)(rand() % 100) / 100.0f - 0.5f, -(float)(rand() % 100) / 100.0f - 0.05f,
+                                 -1.0f));
+        rays.push_back(ray);
+    }
+}
+
+static int linearPick(float& min_t, const std::vector<BBox>& boxes, const Ray& ray)
+{
+    min_t = TMAX;
+    int index = -1;
+    for(int i = 0; i < boxes.size(); i++)
+    {
+        int side;
+        float t = boxes[i].rayIntersect(side, ray);
+        if(t < min_t)
+        {
+            min_t = t;
+            index = i;
+        }
+    }
+    return index;
+}
+
+int main()
+{
+    const int box_counts[] = {1000, 10000, 100000, 1000000};
+    const int num_rays = 10000;
+    std::vector<BBox> boxes;
+    std::vector<Ray> rays;
+
+    printf("%10s %12s %14s %14s %10s\n", "boxes", "build (ms)", "bvh (us/ray)", "linear (us/ray)", "mismatch");
+    for(int c = 0; c < sizeof(box_counts) / sizeof(box_counts[0]); c++)
+    {
+        const int num_boxes = box_counts[c];
+        makeTrack(boxes, num_boxes);
+        makeRays(rays, num_boxes, num_rays);
+
+        BenchClock::time_point start = BenchClock::now();
+        BVH bvh;
+        bvh.build(boxes);
+        double build_time = secondsSince(start);
+
+        std::vector<float> bvh_t(num_rays);
+        start = BenchClock::now();
+        for(int i = 0; i < num_rays; i++)
+        {
+            int face;
+            bvh.rayIntersect(face, bvh_t[i], rays[i]);
+        }
+        double bvh_time = secondsSince(start);
+
+        // Fewer linear picks on big tracks so the run stays short
+        const int num_linear_rays = num_rays * 1000 / num_boxes > 0 ? num_rays * 1000 / num_boxes : 1;
+        int mismatches = 0;
+        start = BenchClock::now();
+        for(int i = 0; i < num_linear_rays; i++)
+        {
+            float t;
+            linearPick(t, boxes, rays[i]);
+            if(t != bvh_t[i])
+            {
+                mismatches++;
+            }
+        }
+        double linear_time = secondsSince(start);
+
+        printf("%10d %12.2f %14.3f %14.3f %10d\n", num_boxes, build_time * 1e3,
+               bvh_time / num_rays * 1e6, linear_time / num_linear_rays * 1e6, mismatches);
+    }
+    return 0;
+}
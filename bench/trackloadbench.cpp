@@ -0,0 +1,88 @@
+/*
+  Track loading benchmark
+  Writes tracks of 10k to 1M boxes in the text and the binary format, then times
+  Track::readFromFile on each and checks both load the same boxes.
+  Build with "make trackloadbench" and run from the repo root. The track files are
+  written to the current directory and removed afterwards.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include "../track.h"
+
+typedef std::chrono::high_resolution_clock BenchClock;
+
+static double secondsSince(const BenchClock::time_point& start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+// Same layout as gridbench: 16 lanes wide along -z, with every 7th box raised a level
+static void makeTrack(Track& track, const int num_boxes)
+{
+    const int num_lanes = 16;
+    track.deleteBoxes();
+    for(int i = 0; i < num_boxes; i++)
+    {
+        float x = (float)(i % num_lanes) - num_lanes / 2;
+        float z = -(float)(i / num_lanes);
+        float y = (i % 7 == 0) ? 1.0f : 0.0f;
+        Vec3 color((float)(i % 3) / 2.0f, 0.5f, 1.0f);
+        track.addBox(Box(Vec3(x, y - 1.0f, z - 1.0f), Vec3(x + 1.0f, y, z), color));
+    }
+}
+
+static double timeLoad(Track& track, const char* file_name)
+{
+    track.deleteBoxes();
+    BenchClock::time_point start = BenchClock::now();
+    track.readFromFile(file_name);
+    return secondsSince(start);
+}
+
+static bool sameBounds(const Track& a, const Track& b)
+{
+    if(a.getNumBoxes() != b.getNumBoxes())
+    {
+        return false;
+    }
+    for(int i = 0; i < a.getNumBoxes(); i++)
+    {
+        const Box& box_a = a.getBoxAtIndex(i);
+        const Box& box_b = b.getBoxAtIndex(i);
+        for(int j = 0; j < 3; j++)
+        {
+            if(box_a.min[j] != box_b.min[j] || box_a.max[j] != box_b.max[j])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    const char* text_name = "trackloadbench.txt";
+    const char* binary_name = "trackloadbench.trk";
+    const int sizes[] = {10000, 100000, 1000000};
+    printf("%10s %12s %12s %10s %8s\n", "boxes", "text ms", "binary ms", "speedup", "match");
+    for(int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        Track track;
+        makeTrack(track, sizes[s]);
+        track.writeToFile(text_name);
+        track.writeToFile(binary_name);
+
+        Track text_track, binary_track;
+        double text_time = timeLoad(text_track, text_name);
+        double binary_time = timeLoad(binary_track, binary_name);
+        bool match = sameBounds(text_track, binary_track) && sameBounds(track, binary_track);
+        printf("%10d %12.2f %12.2f %9.1fx %8s\n", sizes[s], text_time * 1000.0, binary_time * 1000.0,
+               text_time / binary_time, match ? "yes" : "NO");
+    }
+    remove(text_name);
+    remove(binary_name);
+    return 0;
+}
@@ -1,13 +1,8 @@
 #pragma once
 
-#include <vector>
-#include <cassert>
+#include <math.h>
 #include "vec.h"
-#include "shaders/shader.h"
-#include <float.h>
 #include "bbox.h"
-#include <fstream>
-#include <sstream>
 
 static float snapToUnit(const float f)
 {
@@ -29,54 +24,34 @@ static Vec3 snapToGrid(const Vec3& v)
 }
 
 /*
-  Axially aligned box
+  Axially aligned box of the track
   min and max are snapped to multiples of GRID_UNIT
-  continuous_min and continuous_max keep track of the "real" min and max
+  Only plain data, all GPU resources live in TrackRenderer, so boxes can be
+  copied freely and used without a GL context
  */
 class Box : public BBox
 {
 public:
     Box()
-        :BBox()
+        :BBox(), color(1.0f, 1.0f, 1.0f)
     {
     }
     
     Box(const Vec3& a, const Vec3& b)
         :BBox(snapToGrid(a), snapToGrid(b)), color(1.0f, 1.0f, 1.0f)
     {
-        continuous_min = min;
-        continuous_max = max;
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        constructBox();
-        glBindVertexArray(0);        
-        num_vertices = 36;        
     }
+
     Box(const Vec3& a, const Vec3& b, const Vec3& c)
         :BBox(snapToGrid(a), snapToGrid(b)), color(c)
     {
-        continuous_min = min;
-        continuous_max = max;
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        constructBox();
-        glBindVertexArray(0);        
-        num_vertices = 36;        
     }    
-    void deleteBox()
-    {
-        glDeleteBuffers(1, &vbo);
-        glDeleteBuffers(1, &ibo);
-        glDeleteVertexArrays(1, &vao);
-    }
+
     Box makeCopy()
     {
         return Box(min, max, color);
     }
+
     Box(const Vec3& center, const float width, const float height, const float length)
     {
         float half_width = fabs(width) * 0.5f;
@@ -90,116 +65,11 @@ public:
         *this = Box(min, max);
     }
 
-    void setShaderAndAttributes(GLuint shader)
-    {
-        // Setting attributes
-        shader_program = shader;
-        glUseProgram(shader_program);
-        glBindVertexArray(vao);
-        GLsizei stride = sizeof(GLfloat) * 6; // 3 pos + 3 normal 
-        GLint posAttrib = glGetAttribLocation(shader, "position");
-        glEnableVertexAttribArray(posAttrib);
-        glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, stride, 0);
-
-        GLint normAttrib = glGetAttribLocation(shader, "normal");
-        glEnableVertexAttribArray(normAttrib);
-        glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(GLfloat) * 3));        
-
-        glUseProgram(0);
-        glBindVertexArray(0);
-        num_vertices = 36;        
-    }
-
-    void changeLength(const int side_num, const float amount)
-    {
-        const float min_len = 0.1f;
-        switch(side_num)
-        {
-        case 0: // Positive x
-        {
-            continuous_max[0] += amount;
-            float diff = continuous_max[0] - continuous_min[0];
-            if(diff < min_len)
-            {
-                continuous_max[0] += min_len - diff;
-            }
-        } break;
-        case 1: // Negative x
-        {
-            continuous_min[0] -= amount;
-            float diff = continuous_max[0] - continuous_min[0];
-            if(diff < min_len)
-            {
-                continuous_min[0] -= min_len - diff;
-            }
-        } break;
-        case 2: // Positive y
-        {
-            continuous_max[1] += amount;
-            float diff = continuous_max[1] - continuous_min[1];
-            if(diff < min_len)
-            {
-                continuous_max[1] += min_len - diff;
-            }
-        } break;
-        case 3: // Negative y
-        {
-            continuous_min[1] -= amount;
-            float diff = continuous_max[1] - continuous_min[1];
-            if(diff < min_len)
-            {
-                continuous_min[1] -= min_len - diff;
-            }
-        } break;
-        case 4: // Positive z
-        {
-            continuous_max[2] += amount;
-            float diff = continuous_max[2] - continuous_min[2];
-            if(diff < min_len)
-            {
-                continuous_max[2] += min_len - diff;
-            }
-        } break;
-        case 5: // Negative z
-        {
-            continuous_min[2] -= amount;
-            float diff = continuous_max[2] - continuous_min[2];
-            if(diff < min_len)
-            {
-                continuous_min[2] -= min_len - diff;
-            }
-        } break;
-        }
-
-        min = snapToGrid(continuous_min);
-        max = snapToGrid(continuous_max);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        constructBox();
-        glBindVertexArray(0);
-    }
-
-    virtual void move(const Vec3& v)
-    {
-        //BBox::move(v);
-        continuous_min += v;
-        continuous_max += v;
-        min = snapToGrid(continuous_min);
-        max = snapToGrid(continuous_max);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        constructBox();
-        glBindVertexArray(0);
-    }
-
-    void draw()
+    // Snap bounds that were edited continuously, see Selected
+    void setContinuousBounds(const BBox& continuous)
     {
-        glUseProgram(shader_program);
-        glUniform3fv(glGetUniformLocation(shader_program, "diffuse_color"), 1, (const float*)(color.data));
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, num_vertices);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        min = snapToGrid(continuous.min);
+        max = snapToGrid(continuous.max);
     }
 
     Vec3 getSideNormal(const int side_num)
@@ -244,241 +114,6 @@ public:
         color = c;
     }
 
-    void syncMinMax()
-    {
-        continuous_min = min;
-        continuous_max = max;
-    }
-
 private:
-    void constructBox()
-    {
-        Vec3 left_vec(-1.0f, 0.0f, 0.0f);
-        Vec3 right_vec(1.0f, 0.0f, 0.0f);
-        Vec3 up_vec(0.0f, 1.0f, 0.0f);
-        Vec3 down_vec(0.0f, -1.0f, 0.0f);
-        Vec3 plus_z_vec(0.0f, 0.0f, 1.0f);
-        Vec3 minus_z_vec(0.0f, 0.0f, -1.0f);
-
-        Vec3 top_right_forward(max);
-        Vec3 top_right_back(max[0], max[1], min[2]);
-        Vec3 top_left_back(min[0], max[1], min[2]);
-        Vec3 top_left_forward(min[0], max[1], max[2]);
-
-        Vec3 bottom_left_back(min);
-        Vec3 bottom_left_forward(min[0], min[1], max[2]);
-        Vec3 bottom_right_forward(max[0], min[1], max[2]);
-        Vec3 bottom_right_back(max[0], min[1], min[2]);
-
-        		Vec3 vertices[12 * 6]; // 12 faces * 6 Vec3 per face
-		int count = 0;
-		// Top
-		vertices[count++] = top_left_back;
-		vertices[count++] = up_vec;
-		vertices[count++] = top_left_forward;
-		vertices[count++] = up_vec;
-		vertices[count++] = top_right_back;
-		vertices[count++] = up_vec;
-
-		vertices[count++] = top_right_back;
-		vertices[count++] = up_vec;
-		vertices[count++] = top_left_forward;
-		vertices[count++] = up_vec;
-		vertices[count++] = top_right_forward;
-		vertices[count++] = up_vec;
-
-		// Bottom
-		vertices[count++] = bottom_right_back;
-		vertices[count++] = down_vec;
-		vertices[count++] = bottom_right_forward;
-		vertices[count++] = down_vec;
-		vertices[count++] = bottom_left_back;
-		vertices[count++] = down_vec;
-
-		vertices[count++] = bottom_left_back;
-		vertices[count++] = down_vec;
-		vertices[count++] = bottom_right_forward;
-		vertices[count++] = down_vec;
-		vertices[count++] = bottom_left_forward;
-		vertices[count++] = down_vec;
-
-		// Left
-		vertices[count++] = bottom_left_forward;
-        vertices[count++] = left_vec;
-        vertices[count++] = top_left_forward;
-        vertices[count++] = left_vec;
-        vertices[count++] = bottom_left_back;
-        vertices[count++] = left_vec;
-
-        vertices[count++] = bottom_left_back;
-        vertices[count++] = left_vec;
-        vertices[count++] = top_left_forward;
-        vertices[count++] = left_vec;
-        vertices[count++] = top_left_back;
-        vertices[count++] = left_vec;
-
-		// Right
-        vertices[count++] = bottom_right_back;
-        vertices[count++] = right_vec;
-        vertices[count++] = top_right_back;
-        vertices[count++] = right_vec;
-        vertices[count++] = bottom_right_forward;
-        vertices[count++] = right_vec;
-
-        vertices[count++] = bottom_right_forward;
-        vertices[count++] = right_vec;
-        vertices[count++] = top_right_back;
-        vertices[count++] = right_vec;
-        vertices[count++] = top_right_forward;
-        vertices[count++] = right_vec;
-
-		// Forward
-        vertices[count++] = bottom_right_forward;
-        vertices[count++] = plus_z_vec;
-        vertices[count++] = bottom_left_forward;
-        vertices[count++] = plus_z_vec;
-        vertices[count++] = top_right_forward;
-        vertices[count++] = plus_z_vec;
-
-        vertices[count++] = bottom_left_forward;
-        vertices[count++] = plus_z_vec;
-        vertices[count++] = top_right_forward;
-        vertices[count++] = plus_z_vec;
-        vertices[count++] = top_left_forward;
-        vertices[count++] = plus_z_vec;
-
-		// Back
-        vertices[count++] = bottom_left_back;
-        vertices[count++] = minus_z_vec;
-        vertices[count++] = bottom_right_back;
-        vertices[count++] = minus_z_vec;
-        vertices[count++] = top_left_back;
-        vertices[count++] = minus_z_vec;
-
-        vertices[count++] = bottom_right_back;
-        vertices[count++] = minus_z_vec;
-        vertices[count++] = top_right_back;
-        vertices[count++] = minus_z_vec;
-        vertices[count++] = top_left_back;
-        vertices[count++] = minus_z_vec;
-
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 12 * 6 * 3, &(vertices[0][0]), GL_STATIC_DRAW);
-    }
-    
-    int num_vertices;
-    GLuint vao, vbo, ibo;
-    GLuint shader_program;
     Vec3 color;
-    Vec3 continuous_min, continuous_max;
-};
-
-class BoxWireframeDrawer
-{
-public:
-    BoxWireframeDrawer(const Mat4& proj_mat)
-        :num_vertices(24)
-    {
-        glGenVertexArrays(1, &vao);
-        glGenBuffers(1, &vbo);
-
-        shader_program = loadAndLinkShaders("shaders/boxwireframe.vs", "shaders/boxwireframe.fs");
-
-        glUseProgram(shader_program);
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_mat.data[0][0]));
-
-        glUseProgram(0);
-    }
-
-    ~BoxWireframeDrawer()
-    {
-        glDeleteVertexArrays(1, &vao);
-        glDeleteBuffers(1, &vbo);
-        glDeleteBuffers(1, &ibo);
-        glDeleteProgram(shader_program);
-    }
-
-    void drawWireframeOnBox(const Box& box, const Mat4& view_transform)
-    {
-        Vec3 offset(0.01f, 0.01f, 0.01f);
-        Vec3 min = box.min - offset, max = box.max + offset;
-
-        Vec3 top_right_forward(max);
-        Vec3 top_right_back(max[0], max[1], min[2]);
-        Vec3 top_left_back(min[0], max[1], min[2]);
-        Vec3 top_left_forward(min[0], max[1], max[2]);
-        Vec3 bottom_left_back(min);
-        Vec3 bottom_left_forward(min[0], min[1], max[2]);
-        Vec3 bottom_right_forward(max[0], min[1], max[2]);
-        Vec3 bottom_right_back(max[0], min[1], min[2]);        
-
-        std::vector<GLfloat> vertices;
-        // Top
-        vertices.insert(vertices.end(), top_left_back.data, top_left_back.data+3);
-        vertices.insert(vertices.end(), top_left_forward.data, top_left_forward.data+3);
-        vertices.insert(vertices.end(), top_right_forward.data, top_right_forward.data+3);
-        vertices.insert(vertices.end(), top_right_back.data, top_right_back.data+3);
-
-        // Bottom
-        vertices.insert(vertices.end(), bottom_right_back.data, bottom_right_back.data+3);
-        vertices.insert(vertices.end(), bottom_right_forward.data, bottom_right_forward.data+3);
-        vertices.insert(vertices.end(), bottom_left_forward.data, bottom_left_forward.data+3);
-        vertices.insert(vertices.end(), bottom_left_back.data, bottom_left_back.data+3);
-
-        // Left
-        vertices.insert(vertices.end(), bottom_left_forward.data, bottom_left_forward.data+3);
-        vertices.insert(vertices.end(), top_left_forward.data, top_left_forward.data+3);
-        vertices.insert(vertices.end(), top_left_back.data, top_left_back.data+3);
-        vertices.insert(vertices.end(), bottom_left_back.data, bottom_left_back.data+3);
-
-        // Right
-        vertices.insert(vertices.end(), bottom_right_back.data, bottom_right_back.data+3);
-        vertices.insert(vertices.end(), top_right_back.data, top_right_back.data+3);
-        vertices.insert(vertices.end(), top_right_forward.data, top_right_forward.data+3);
-        vertices.insert(vertices.end(), bottom_right_forward.data, bottom_right_forward.data+3);
-
-        // Forward
-        vertices.insert(vertices.end(), bottom_right_forward.data, bottom_right_forward.data+3);
-        vertices.insert(vertices.end(), bottom_left_forward.data, bottom_left_forward.data+3);
-        vertices.insert(vertices.end(), top_left_forward.data, top_left_forward.data+3);
-        vertices.insert(vertices.end(), top_right_forward.data, top_right_forward.data+3);
-
-        // Back
-        vertices.insert(vertices.end(), bottom_left_back.data, bottom_left_back.data+3);
-        vertices.insert(vertices.end(), bottom_right_back.data, bottom_right_back.data+3);
-        vertices.insert(vertices.end(), top_right_back.data, top_right_back.data+3);                
-        vertices.insert(vertices.end(), top_left_back.data, top_left_back.data+3);
-        
-
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), &(vertices[0]), GL_DYNAMIC_DRAW);
-        glUseProgram(shader_program);
-        
-        // set attributes
-        GLsizei stride = sizeof(GLfloat) * 3; // 3 pos
-        GLint pos_attrib = glGetAttribLocation(shader_program, "position");
-        glEnableVertexAttribArray(pos_attrib);
-        glVertexAttribPointer(pos_attrib, 3, GL_FLOAT, GL_FALSE, stride, 0);
-        
-        // set uniforms
-        GLint view_handle = glGetUniformLocation(shader_program, "view_mat");
-        glUniformMatrix4fv(view_handle, 1, GL_TRUE, &(view_transform.data[0][0]));
-                          
-        glDrawArrays(GL_LINE_STRIP, 0, num_vertices);
-        glBindVertexArray(0);
-        glUseProgram(0);
-    }
-
-    void setProjTransform(const Mat4& proj_transform)
-    {
-        glUseProgram(shader_program);
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-        glUseProgram(0);
-    }            
-private:    
-    int num_vertices;
-    GLuint vao, vbo, ibo;
-    GLuint shader_program;
 };
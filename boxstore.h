@@ -0,0 +1,273 @@
+#pragma once
+#include <cstdlib>
+#include <cstring>
+#include <float.h>
+#include "bbox.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BOX_STORE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/*
+  Structure of arrays copy of the track's box bounds for collision tests
+  Each of min_x ... max_z is a 32 byte aligned float array. The arrays are padded to
+  a multiple of 8 with empty boxes (min FLT_MAX, max -FLT_MAX) that never overlap
+  anything, so the SIMD kernels never need a scalar tail loop.
+  overlapQuery tests one bbox against 8 boxes per instruction with AVX2, 4 with SSE,
+  and falls back to a scalar loop elsewhere. The kernel is picked once at runtime.
+ */
+class BoxStore
+{
+public:
+    static const int SIMD_WIDTH = 8;
+
+    BoxStore()
+        :num_boxes(0), capacity(0)
+    {
+        for(int i = 0; i < 6; i++)
+        {
+            arrays[i] = nullptr;
+        }
+    }
+
+    BoxStore(const BoxStore&) = delete;
+    BoxStore& operator=(const BoxStore&) = delete;
+
+    ~BoxStore()
+    {
+        for(int i = 0; i < 6; i++)
+        {
+            alignedFree(arrays[i]);
+        }
+    }
+
+    void clear()
+    {
+        for(int i = 0; i < num_boxes; i++)
+        {
+            setEmpty(i);
+        }
+        num_boxes = 0;
+    }
+
+    void reserve(const int n)
+    {
+        int new_capacity = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+        if(new_capacity <= capacity)
+        {
+            return;
+        }
+        for(int i = 0; i < 6; i++)
+        {
+            float* new_array = (float*)alignedAlloc(sizeof(float) * new_capacity);
+            if(arrays[i])
+            {
+                memcpy(new_array, arrays[i], sizeof(float) * capacity);
+                alignedFree(arrays[i]);
+            }
+            arrays[i] = new_array;
+        }
+        for(int i = capacity; i < new_capacity; i++)
+        {
+            setEmpty(i);
+        }
+        capacity = new_capacity;
+    }
+
+    int push(const BBox& bbox)
+    {
+        if(num_boxes == capacity)
+        {
+            reserve(capacity > 0 ? capacity * 2 : 64);
+        }
+        set(num_boxes, bbox);
+        return num_boxes++;
+    }
+
+    void set(const int index, const BBox& bbox)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            arrays[i][index] = bbox.min[i];
+            arrays[i + 3][index] = bbox.max[i];
+        }
+    }
+
+    // Move the last box into index
+    void swapRemove(const int index)
+    {
+        int last = num_boxes - 1;
+        for(int i = 0; i < 6; i++)
+        {
+            arrays[i][index] = arrays[i][last];
+        }
+        setEmpty(last);
+        num_boxes--;
+    }
+
+    int size() const
+    {
+        return num_boxes;
+    }
+
+    // Write the indices of the boxes that intersect bbox into results
+    // Returns the number of indices written, which is at most max_results
+    int overlapQuery(int* results, const int max_results, const BBox& bbox) const
+    {
+        static const QueryKernel kernel = pickKernel();
+        return (this->*kernel)(results, max_results, bbox);
+    }
+
+    int overlapQueryScalar(int* results, const int max_results, const BBox& bbox) const
+    {
+        const float* min_x = arrays[0];
+        const float* min_y = arrays[1];
+        const float* min_z = arrays[2];
+        const float* max_x = arrays[3];
+        const float* max_y = arrays[4];
+        const float* max_z = arrays[5];
+        int count = 0;
+        for(int i = 0; i < num_boxes && count < max_results; i++)
+        {
+            bool overlap = (max_x[i] >= bbox.min[0]) & (min_x[i] <= bbox.max[0]) &
+                (max_y[i] >= bbox.min[1]) & (min_y[i] <= bbox.max[1]) &
+                (max_z[i] >= bbox.min[2]) & (min_z[i] <= bbox.max[2]);
+            if(overlap)
+            {
+                results[count++] = i;
+            }
+        }
+        return count;
+    }
+
+#ifdef BOX_STORE_X86_SIMD
+    __attribute__((target("sse2")))
+    int overlapQuerySSE(int* results, const int max_results, const BBox& bbox) const
+    {
+        const __m128 q_min_x = _mm_set1_ps(bbox.min[0]);
+        const __m128 q_min_y = _mm_set1_ps(bbox.min[1]);
+        const __m128 q_min_z = _mm_set1_ps(bbox.min[2]);
+        const __m128 q_max_x = _mm_set1_ps(bbox.max[0]);
+        const __m128 q_max_y = _mm_set1_ps(bbox.max[1]);
+        const __m128 q_max_z = _mm_set1_ps(bbox.max[2]);
+        int count = 0;
+        for(int i = 0; i < num_boxes; i += 4)
+        {
+            __m128 overlap = _mm_and_ps(_mm_cmpge_ps(_mm_load_ps(arrays[3] + i), q_min_x),
+                                        _mm_cmple_ps(_mm_load_ps(arrays[0] + i), q_max_x));
+            overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(arrays[4] + i), q_min_y));
+            overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(arrays[1] + i), q_max_y));
+            overlap = _mm_and_ps(overlap, _mm_cmpge_ps(_mm_load_ps(arrays[5] + i), q_min_z));
+            overlap = _mm_and_ps(overlap, _mm_cmple_ps(_mm_load_ps(arrays[2] + i), q_max_z));
+            unsigned int mask = _mm_movemask_ps(overlap);
+            if(!appendMask(results, count, max_results, mask, i))
+            {
+                break;
+            }
+        }
+        return count;
+    }
+
+    __attribute__((target("avx2")))
+    int overlapQueryAVX2(int* results, const int max_results, const BBox& bbox) const
+    {
+        const __m256 q_min_x = _mm256_set1_ps(bbox.min[0]);
+        const __m256 q_min_y = _mm256_set1_ps(bbox.min[1]);
+        const __m256 q_min_z = _mm256_set1_ps(bbox.min[2]);
+        const __m256 q_max_x = _mm256_set1_ps(bbox.max[0]);
+        const __m256 q_max_y = _mm256_set1_ps(bbox.max[1]);
+        const __m256 q_max_z = _mm256_set1_ps(bbox.max[2]);
+        int count = 0;
+        for(int i = 0; i < num_boxes; i += 8)
+        {
+            __m256 overlap = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(arrays[3] + i), q_min_x, _CMP_GE_OQ),
+                                           _mm256_cmp_ps(_mm256_load_ps(arrays[0] + i), q_max_x, _CMP_LE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_load_ps(arrays[4] + i), q_min_y, _CMP_GE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_load_ps(arrays[1] + i), q_max_y, _CMP_LE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_load_ps(arrays[5] + i), q_min_z, _CMP_GE_OQ));
+            overlap = _mm256_and_ps(overlap, _mm256_cmp_ps(_mm256_load_ps(arrays[2] + i), q_max_z, _CMP_LE_OQ));
+            unsigned int mask = _mm256_movemask_ps(overlap);
+            if(!appendMask(results, count, max_results, mask, i))
+            {
+                break;
+            }
+        }
+        return count;
+    }
+#endif
+
+private:
+    typedef int (BoxStore::*QueryKernel)(int*, const int, const BBox&) const;
+
+    static QueryKernel pickKernel()
+    {
+#ifdef BOX_STORE_X86_SIMD
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+        {
+            return &BoxStore::overlapQueryAVX2;
+        }
+        if(__builtin_cpu_supports("sse2"))
+        {
+            return &BoxStore::overlapQuerySSE;
+        }
+#endif
+        return &BoxStore::overlapQueryScalar;
+    }
+
+#ifdef BOX_STORE_X86_SIMD
+    // Returns false once results is full
+    static bool appendMask(int* results, int& count, const int max_results, unsigned int mask, const int base)
+    {
+        while(mask)
+        {
+            if(count == max_results)
+            {
+                return false;
+            }
+            int bit = __builtin_ctz(mask);
+            results[count++] = base + bit;
+            mask &= mask - 1;
+        }
+        return true;
+    }
+#endif
+
+    void setEmpty(const int index)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            arrays[i][index] = FLT_MAX;
+            arrays[i + 3][index] = -FLT_MAX;
+        }
+    }
+
+    static void* alignedAlloc(const size_t size)
+    {
+#ifdef _MSC_VER
+        return _aligned_malloc(size, 32);
+#else
+        void* ptr = nullptr;
+        if(posix_memalign(&ptr, 32, size) != 0)
+        {
+            return nullptr;
+        }
+        return ptr;
+#endif
+    }
+
+    static void alignedFree(void* ptr)
+    {
+#ifdef _MSC_VER
+        _aligned_free(ptr);
+#else
+        free(ptr);
+#endif
+    }
+
+    // min_x, min_y, min_z, max_x, max_y, max_z
+    float* arrays[6];
+    int num_boxes;
+    int capacity;
+};
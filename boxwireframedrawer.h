@@ -0,0 +1,154 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include "mat.h"
+#include "bbox.h"
+#include "selected.h"
+#include "glstate.h"
+#include "streambuffer.h"
+#include "renderqueue.h"
+#include "shaders/shaderregistry.h"
+
+/*
+  Draws wireframes on the selected boxes
+  The 12 edges of a unit cube are one static line mesh, boxwireframe.vs stretches
+  it over each box's min and max from an instance buffer, so every wireframe is
+  one instanced draw in the overlay pass. The instance buffer is only rewritten when the
+  selection's revision changes, by a GPU copy from g_stream_buffer.
+ */
+class BoxWireframeDrawer
+{
+public:
+    BoxWireframeDrawer()
+        :num_instances(0), instance_capacity(0), uploaded_revision(-1)
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &edge_vbo);
+        glGenBuffers(1, &instance_vbo);
+
+        shader_program = g_shaders.getProgram("shaders/boxwireframe.vs", "shaders/boxwireframe.fs");
+
+        std::vector<GLfloat> edge_vertices;
+        appendUnitCubeEdges(edge_vertices);
+        g_gl_state.bindVertexArray(vao);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, edge_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * edge_vertices.size(), &(edge_vertices[0]), GL_STATIC_DRAW);
+        GLint pos_attrib = g_shaders.getAttrib(shader_program, "position").location;
+        glEnableVertexAttribArray(pos_attrib);
+        glVertexAttribPointer(pos_attrib, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, 0);
+
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+        GLsizei instance_stride = sizeof(GLfloat) * FLOATS_PER_INSTANCE; // 3 min + 3 max
+        const char* instance_attribs[2] = {"instance_min", "instance_max"};
+        for(int i = 0; i < 2; i++)
+        {
+            GLint attrib = g_shaders.getAttrib(shader_program, instance_attribs[i]).location;
+            glEnableVertexAttribArray(attrib);
+            glVertexAttribPointer(attrib, 3, GL_FLOAT, GL_FALSE, instance_stride,
+                                  (const void*)(sizeof(GLfloat) * 3 * i));
+            glVertexAttribDivisor(attrib, 1);
+        }
+        g_gl_state.bindVertexArray(0);
+    }
+
+    BoxWireframeDrawer(const BoxWireframeDrawer&) = delete;
+    BoxWireframeDrawer& operator=(const BoxWireframeDrawer&) = delete;
+
+    ~BoxWireframeDrawer()
+    {
+        g_gl_state.deleteVertexArray(vao);
+        g_gl_state.deleteBuffer(edge_vbo);
+        g_gl_state.deleteBuffer(instance_vbo);
+    }
+
+    // Call once per frame before drawing, does nothing unless the selection changed
+    void update(const Selected& selected)
+    {
+        if(selected.getRevision() == uploaded_revision)
+        {
+            return;
+        }
+        uploaded_revision = selected.getRevision();
+        num_instances = selected.getNumSelected();
+        if(num_instances == 0)
+        {
+            return;
+        }
+        // Slightly bigger than the box so the lines aren't hidden in its faces
+        Vec3 offset(0.01f, 0.01f, 0.01f);
+        const GLsizeiptr size = sizeof(GLfloat) * FLOATS_PER_INSTANCE * num_instances;
+        GLintptr staging_offset;
+        GLfloat* staging = (GLfloat*)g_stream_buffer.map(size, staging_offset);
+        for(int i = 0; i < num_instances; i++)
+        {
+            const Box& box = selected.getBox(i);
+            Vec3 min = box.min - offset, max = box.max + offset;
+            GLfloat* instance = staging + i * FLOATS_PER_INSTANCE;
+            for(int j = 0; j < 3; j++)
+            {
+                instance[j] = min[j];
+                instance[j + 3] = max[j];
+            }
+        }
+        g_stream_buffer.unmap();
+
+        g_gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, instance_vbo);
+        if(num_instances > instance_capacity)
+        {
+            instance_capacity = num_instances + num_instances / 2 + 64;
+            glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLfloat) * FLOATS_PER_INSTANCE * instance_capacity, nullptr,
+                         GL_DYNAMIC_DRAW);
+        }
+        g_gl_state.bindBuffer(GL_COPY_READ_BUFFER, g_stream_buffer.getBuffer());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staging_offset, 0, size);
+    }
+
+    void submit(RenderQueue& queue) const
+    {
+        if(num_instances == 0)
+        {
+            return;
+        }
+        queue.submit(PASS_OVERLAY, shader_program, vao, 0, 0.0f, drawInstances, this, 0, num_instances);
+    }
+
+private:
+    static const int FLOATS_PER_INSTANCE = 6;
+    static const int VERTICES_PER_BOX = 24;
+
+    static void drawInstances(const DrawItem& item)
+    {
+        g_gl_state.drawArraysInstanced(GL_LINES, 0, VERTICES_PER_BOX, item.count);
+    }
+
+    static void appendEdge(std::vector<GLfloat>& vertices, const Vec3& a, const Vec3& b)
+    {
+        vertices.insert(vertices.end(), a.data, a.data + 3);
+        vertices.insert(vertices.end(), b.data, b.data + 3);
+    }
+
+    // Edges of the cube from (0, 0, 0) to (1, 1, 1) as line pairs
+    static void appendUnitCubeEdges(std::vector<GLfloat>& vertices)
+    {
+        for(int axis = 0; axis < 3; axis++)
+        {
+            int u = (axis + 1) % 3, v = (axis + 2) % 3;
+            // Four edges parallel to each axis, one at each corner of the other two
+            for(int corner = 0; corner < 4; corner++)
+            {
+                Vec3 a(0.0f, 0.0f, 0.0f);
+                a[u] = (float)(corner & 1);
+                a[v] = (float)(corner >> 1);
+                Vec3 b(a);
+                b[axis] = 1.0f;
+                appendEdge(vertices, a, b);
+            }
+        }
+    }
+
+    GLuint vao, edge_vbo, instance_vbo;
+    GLuint shader_program;
+    int num_instances;
+    int instance_capacity;
+    int uploaded_revision;
+};
@@ -0,0 +1,608 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include "constants.h"
+#include "ray.h"
+#include "bbox.h"
+#include "frustum.h"
+
+/*
+  Bounding volume hierarchy over axially aligned boxes
+  Built top down with binned SAH. Every leaf holds exactly one box, identified by
+  its index in the array the tree was built from.
+  rayIntersect finds the same nearest hit as calling BBox::rayIntersect on every box,
+  though boxes hit at exactly the same t may be picked in a different order.
+  It visits children front to back and skips any node that starts beyond the
+  closest hit found so far.
+  insert, remove and update change single boxes in O(log n) for editing. Inserts walk
+  down to the sibling that grows the surface area least, like Box2D's dynamic tree,
+  so the tree slowly gets worse than a fresh build; needsRebuild says when to build again.
+ */
+struct BVHNode
+{
+    BBox bounds;
+    int parent;
+    int left, right;
+    int prim;       // Box index for leaves, -1 for interior nodes
+    int height;     // Nodes on the longest path down to a leaf, 1 for leaves
+
+    bool isLeaf() const
+    {
+        return prim != -1;
+    }
+};
+
+class BVH
+{
+public:
+    BVH()
+        :root(-1), max_depth(0), built_depth(0), num_updates(0), num_built(0)
+    {
+    }
+
+    void clear()
+    {
+        nodes.clear();
+        free_nodes.clear();
+        leaf_of_prim.clear();
+        root = -1;
+        max_depth = 0;
+        built_depth = 0;
+        num_updates = 0;
+        num_built = 0;
+    }
+
+    template <typename BoxType>
+    void build(const std::vector<BoxType>& boxes)
+    {
+        clear();
+        int num_prims = boxes.size();
+        if(num_prims == 0)
+        {
+            return;
+        }
+        std::vector<BuildPrim> prims(num_prims);
+        for(int i = 0; i < num_prims; i++)
+        {
+            prims[i].bounds = BBox(boxes[i].min, boxes[i].max);
+            prims[i].centroid = (boxes[i].min + boxes[i].max) * 0.5f;
+            prims[i].index = i;
+        }
+        nodes.reserve(num_prims * 2 - 1);
+        leaf_of_prim.resize(num_prims, -1);
+        root = buildRecursive(prims, 0, num_prims, -1);
+        max_depth = built_depth = nodes[root].height;
+        num_built = num_prims;
+    }
+
+    // Add box index prim with bounds bbox
+    void insert(const int prim, const BBox& bbox)
+    {
+        if(prim >= (int)leaf_of_prim.size())
+        {
+            leaf_of_prim.resize(prim + 1, -1);
+        }
+        assert(leaf_of_prim[prim] == -1);
+        num_updates++;
+        int leaf = allocNode();
+        nodes[leaf].bounds = bbox;
+        nodes[leaf].parent = nodes[leaf].left = nodes[leaf].right = -1;
+        nodes[leaf].prim = prim;
+        nodes[leaf].height = 1;
+        leaf_of_prim[prim] = leaf;
+        if(root == -1)
+        {
+            root = leaf;
+            max_depth = 1;
+            return;
+        }
+
+        // Stop at the node where pairing with the new leaf is cheaper than going further down
+        int sibling = root;
+        while(!nodes[sibling].isLeaf())
+        {
+            const BVHNode& node = nodes[sibling];
+            BBox combined = node.bounds;
+            enlarge(combined, bbox);
+            float combined_area = halfArea(combined);
+            float pair_cost = 2.0f * combined_area;
+            // Every node above the new leaf grows by the same amount whichever way it goes
+            float inherited_cost = 2.0f * (combined_area - halfArea(node.bounds));
+            float left_cost = descendCost(nodes[node.left], bbox) + inherited_cost;
+            float right_cost = descendCost(nodes[node.right], bbox) + inherited_cost;
+            if(pair_cost < left_cost && pair_cost < right_cost)
+            {
+                break;
+            }
+            sibling = left_cost < right_cost ? node.left : node.right;
+        }
+
+        int new_parent = allocNode();
+        int old_parent = nodes[sibling].parent;
+        nodes[new_parent].parent = old_parent;
+        nodes[new_parent].left = sibling;
+        nodes[new_parent].right = leaf;
+        nodes[new_parent].prim = -1;
+        nodes[sibling].parent = new_parent;
+        nodes[leaf].parent = new_parent;
+        if(old_parent == -1)
+        {
+            root = new_parent;
+        }else if(nodes[old_parent].left == sibling)
+        {
+            nodes[old_parent].left = new_parent;
+        }else
+        {
+            nodes[old_parent].right = new_parent;
+        }
+        refitAncestors(new_parent);
+    }
+
+    void remove(const int prim)
+    {
+        if(prim < 0 || prim >= (int)leaf_of_prim.size() || leaf_of_prim[prim] == -1)
+        {
+            return;
+        }
+        num_updates++;
+        int leaf = leaf_of_prim[prim];
+        leaf_of_prim[prim] = -1;
+        if(leaf == root)
+        {
+            root = -1;
+            max_depth = 0;
+            freeNode(leaf);
+            return;
+        }
+        int parent = nodes[leaf].parent;
+        int grandparent = nodes[parent].parent;
+        int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+        // The sibling takes the parent's place
+        nodes[sibling].parent = grandparent;
+        if(grandparent == -1)
+        {
+            root = sibling;
+            max_depth = nodes[root].height;
+        }else
+        {
+            if(nodes[grandparent].left == parent)
+            {
+                nodes[grandparent].left = sibling;
+            }else
+            {
+                nodes[grandparent].right = sibling;
+            }
+            refitAncestors(grandparent);
+        }
+        freeNode(parent);
+        freeNode(leaf);
+    }
+
+    // Call after the bounds of box prim change
+    void update(const int prim, const BBox& bbox)
+    {
+        remove(prim);
+        insert(prim, bbox);
+    }
+
+    // The box at index old_prim now lives at new_prim, e.g. after a swap and pop
+    void relabel(const int old_prim, const int new_prim)
+    {
+        if(old_prim == new_prim || old_prim >= (int)leaf_of_prim.size() || leaf_of_prim[old_prim] == -1)
+        {
+            return;
+        }
+        if(new_prim >= (int)leaf_of_prim.size())
+        {
+            leaf_of_prim.resize(new_prim + 1, -1);
+        }
+        assert(leaf_of_prim[new_prim] == -1);
+        int leaf = leaf_of_prim[old_prim];
+        nodes[leaf].prim = new_prim;
+        leaf_of_prim[new_prim] = leaf;
+        leaf_of_prim[old_prim] = -1;
+        while(!leaf_of_prim.empty() && leaf_of_prim.back() == -1)
+        {
+            leaf_of_prim.pop_back();
+        }
+    }
+
+    // True once incremental changes have made the tree deeper than the last build and deep
+    // enough to risk the traversal stack, or outnumber the boxes the last build saw
+    // A fresh build never needs another one, however deep it is
+    bool needsRebuild() const
+    {
+        if(num_updates == 0)
+        {
+            return false;
+        }
+        return max_depth > std::max(built_depth, MAX_STACK_DEPTH / 2) || num_updates > std::max(num_built, 64);
+    }
+
+    int rayIntersect(int& face, float& t, const Ray& ray) const
+    {
+        return rayIntersect(face, t, ray, [](const int){ return true; });
+    }
+
+    // accept(box_index) decides which boxes can be hit, e.g. only selected ones
+    template <typename Filter>
+    int rayIntersect(int& face, float& t, const Ray& ray, Filter accept) const
+    {
+        float min_t = TMAX;
+        int min_index = -1, min_face = -1;
+        if(root == -1)
+        {
+            face = min_face;
+            t = min_t;
+            return min_index;
+        }
+        Vec3 inv_dir(1.0f / ray.dir[0], 1.0f / ray.dir[1], 1.0f / ray.dir[2]);
+
+        // The stack holds at most one pending sibling per level plus the two children
+        // of the node being visited, trees too deep for the fixed one get a heap stack
+        StackEntry fixed_stack[MAX_STACK_DEPTH];
+        std::vector<StackEntry> heap_stack;
+        StackEntry* stack = fixed_stack;
+        int stack_capacity = MAX_STACK_DEPTH;
+        if(max_depth + 1 > stack_capacity)
+        {
+            stack_capacity = max_depth + 1;
+            heap_stack.resize(stack_capacity);
+            stack = &(heap_stack[0]);
+        }
+        int stack_size = 0;
+        float root_t = 0.0f;
+        if(nodeEntryTime(root_t, nodes[root].bounds, ray, inv_dir))
+        {
+            stack[stack_size].node = root;
+            stack[stack_size].t = root_t;
+            stack_size++;
+        }
+        while(stack_size > 0)
+        {
+            StackEntry entry = stack[--stack_size];
+            if(entry.t >= min_t)
+            {
+                continue;
+            }
+            const BVHNode& node = nodes[entry.node];
+            if(node.isLeaf())
+            {
+                if(!accept(node.prim))
+                {
+                    continue;
+                }
+                int side = -1;
+                float leaf_t = node.bounds.rayIntersect(side, ray);
+                if(leaf_t < min_t)
+                {
+                    min_t = leaf_t;
+                    min_index = node.prim;
+                    min_face = side;
+                }
+                continue;
+            }
+
+            float left_t = 0.0f, right_t = 0.0f;
+            bool hit_left = nodeEntryTime(left_t, nodes[node.left].bounds, ray, inv_dir) && left_t < min_t;
+            bool hit_right = nodeEntryTime(right_t, nodes[node.right].bounds, ray, inv_dir) && right_t < min_t;
+            assert(stack_size + 2 <= stack_capacity);
+            // Push the far child first so the near one is popped next
+            if(hit_left && hit_right)
+            {
+                bool left_first = left_t <= right_t;
+                stack[stack_size].node = left_first ? node.right : node.left;
+                stack[stack_size].t = left_first ? right_t : left_t;
+                stack_size++;
+                stack[stack_size].node = left_first ? node.left : node.right;
+                stack[stack_size].t = left_first ? left_t : right_t;
+                stack_size++;
+            }else if(hit_left)
+            {
+                stack[stack_size].node = node.left;
+                stack[stack_size].t = left_t;
+                stack_size++;
+            }else if(hit_right)
+            {
+                stack[stack_size].node = node.right;
+                stack[stack_size].t = right_t;
+                stack_size++;
+            }
+        }
+        face = min_face;
+        t = min_t;
+        return min_index;
+    }
+
+    // Append the index of every box at least partly inside frustum to box_indices
+    // Subtrees entirely inside are added without testing their boxes
+    void frustumQuery(std::vector<int>& box_indices, const Frustum& frustum) const
+    {
+        if(root == -1)
+        {
+            return;
+        }
+        // Same bound as the ray stack, one pending right child per level plus one
+        CullEntry fixed_stack[MAX_STACK_DEPTH];
+        std::vector<CullEntry> heap_stack;
+        CullEntry* stack = fixed_stack;
+        int stack_capacity = MAX_STACK_DEPTH;
+        if(max_depth + 1 > stack_capacity)
+        {
+            stack_capacity = max_depth + 1;
+            heap_stack.resize(stack_capacity);
+            stack = &(heap_stack[0]);
+        }
+        int stack_size = 0;
+        stack[stack_size].node = root;
+        stack[stack_size].plane_mask = Frustum::ALL_PLANES;
+        stack_size++;
+        while(stack_size > 0)
+        {
+            CullEntry entry = stack[--stack_size];
+            const BVHNode& node = nodes[entry.node];
+            // An empty mask means an ancestor was inside every plane
+            if(entry.plane_mask != 0 &&
+               frustum.classifyBBox(node.bounds, entry.plane_mask) == Frustum::OUTSIDE)
+            {
+                continue;
+            }
+            if(node.isLeaf())
+            {
+                box_indices.push_back(node.prim);
+                continue;
+            }
+            assert(stack_size + 2 <= stack_capacity);
+            stack[stack_size].node = node.left;
+            stack[stack_size].plane_mask = entry.plane_mask;
+            stack_size++;
+            stack[stack_size].node = node.right;
+            stack[stack_size].plane_mask = entry.plane_mask;
+            stack_size++;
+        }
+    }
+
+    int getNumNodes() const
+    {
+        return nodes.size() - free_nodes.size();
+    }
+
+private:
+    static const int MAX_STACK_DEPTH = 256;
+    static const int NUM_SAH_BINS = 16;
+
+    struct BuildPrim
+    {
+        BBox bounds;
+        Vec3 centroid;
+        int index;
+    };
+
+    struct StackEntry
+    {
+        int node;
+        float t;
+    };
+
+    struct CullEntry
+    {
+        int node;
+        unsigned int plane_mask;
+    };
+
+    // Slab test that treats a ray starting inside the box as entering at 0
+    static bool nodeEntryTime(float& t_entry, const BBox& bbox, const Ray& ray, const Vec3& inv_dir)
+    {
+        float t0 = -FLT_MAX, t1 = FLT_MAX;
+        for(int i = 0; i < 3; i++)
+        {
+            float t_near = (bbox.min[i] - ray.origin[i]) * inv_dir[i];
+            float t_far = (bbox.max[i] - ray.origin[i]) * inv_dir[i];
+            if(t_near > t_far)
+            {
+                std::swap(t_near, t_far);
+            }
+            t0 = t_near > t0 ? t_near : t0;
+            t1 = t_far < t1 ? t_far : t1;
+        }
+        if(t0 > t1 || t1 <= K_EPSILON)
+        {
+            return false;
+        }
+        t_entry = t0 > 0.0f ? t0 : 0.0f;
+        return true;
+    }
+
+    static float halfArea(const BBox& bbox)
+    {
+        Vec3 d = bbox.max - bbox.min;
+        return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+    }
+
+    static void enlarge(BBox& bbox, const BBox& other)
+    {
+        bbox.enlargeTo(other.min);
+        bbox.enlargeTo(other.max);
+    }
+
+    static BBox emptyBBox()
+    {
+        return BBox(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+    }
+
+    int allocNode()
+    {
+        if(!free_nodes.empty())
+        {
+            int node_index = free_nodes.back();
+            free_nodes.pop_back();
+            return node_index;
+        }
+        nodes.push_back(BVHNode());
+        return nodes.size() - 1;
+    }
+
+    void freeNode(const int node_index)
+    {
+        nodes[node_index].parent = nodes[node_index].left = nodes[node_index].right = -1;
+        nodes[node_index].prim = -1;
+        free_nodes.push_back(node_index);
+    }
+
+    // Lower bound on the cost of putting a new leaf with bounds bbox somewhere under node
+    static float descendCost(const BVHNode& node, const BBox& bbox)
+    {
+        BBox combined = node.bounds;
+        enlarge(combined, bbox);
+        if(node.isLeaf())
+        {
+            return 2.0f * halfArea(combined);
+        }
+        return 2.0f * (halfArea(combined) - halfArea(node.bounds));
+    }
+
+    // Recompute the bounds and height of node_index and everything above it from their children
+    void refitAncestors(int node_index)
+    {
+        while(node_index != -1)
+        {
+            BVHNode& node = nodes[node_index];
+            node.bounds = nodes[node.left].bounds;
+            enlarge(node.bounds, nodes[node.right].bounds);
+            node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+            node_index = node.parent;
+        }
+        max_depth = nodes[root].height;
+    }
+
+    int buildRecursive(std::vector<BuildPrim>& prims, const int begin, const int end, const int parent)
+    {
+        int node_index = allocNode();
+        nodes[node_index].parent = parent;
+        if(end - begin == 1)
+        {
+            nodes[node_index].bounds = prims[begin].bounds;
+            nodes[node_index].left = nodes[node_index].right = -1;
+            nodes[node_index].prim = prims[begin].index;
+            nodes[node_index].height = 1;
+            leaf_of_prim[prims[begin].index] = node_index;
+            return node_index;
+        }
+
+        BBox bounds = emptyBBox();
+        BBox centroid_bounds = emptyBBox();
+        for(int i = begin; i < end; i++)
+        {
+            enlarge(bounds, prims[i].bounds);
+            centroid_bounds.enlargeTo(prims[i].centroid);
+        }
+        nodes[node_index].bounds = bounds;
+        nodes[node_index].prim = -1;
+
+        int axis = 0;
+        Vec3 extent = centroid_bounds.max - centroid_bounds.min;
+        if(extent[1] > extent[axis]) axis = 1;
+        if(extent[2] > extent[axis]) axis = 2;
+
+        int mid = begin + (end - begin) / 2;
+        if(extent[axis] > 0.0f)
+        {
+            mid = partitionSAH(prims, begin, end, axis, centroid_bounds);
+        }
+        if(mid == begin || mid == end)
+        {
+            // All centroids in one bin, split by count instead
+            mid = begin + (end - begin) / 2;
+            std::nth_element(prims.begin() + begin, prims.begin() + mid, prims.begin() + end,
+                             [axis](const BuildPrim& a, const BuildPrim& b)
+                             {
+                                 return a.centroid[axis] < b.centroid[axis];
+                             });
+        }
+
+        int left = buildRecursive(prims, begin, mid, node_index);
+        int right = buildRecursive(prims, mid, end, node_index);
+        nodes[node_index].left = left;
+        nodes[node_index].right = right;
+        nodes[node_index].height = 1 + std::max(nodes[left].height, nodes[right].height);
+        return node_index;
+    }
+
+    // Returns the first index of the right partition
+    int partitionSAH(std::vector<BuildPrim>& prims, const int begin, const int end, const int axis,
+                     const BBox& centroid_bounds)
+    {
+        BBox bin_bounds[NUM_SAH_BINS];
+        int bin_counts[NUM_SAH_BINS];
+        for(int i = 0; i < NUM_SAH_BINS; i++)
+        {
+            bin_bounds[i] = emptyBBox();
+            bin_counts[i] = 0;
+        }
+        const float axis_min = centroid_bounds.min[axis];
+        const float bin_scale = NUM_SAH_BINS * 0.9999f / (centroid_bounds.max[axis] - axis_min);
+        for(int i = begin; i < end; i++)
+        {
+            int bin = (int)((prims[i].centroid[axis] - axis_min) * bin_scale);
+            bin_counts[bin]++;
+            enlarge(bin_bounds[bin], prims[i].bounds);
+        }
+
+        // Sweep from the right to get the cost of every right partition, then from the left
+        float right_area[NUM_SAH_BINS];
+        int right_count[NUM_SAH_BINS];
+        BBox sweep = emptyBBox();
+        int count = 0;
+        for(int i = NUM_SAH_BINS - 1; i > 0; i--)
+        {
+            if(bin_counts[i] > 0)
+            {
+                enlarge(sweep, bin_bounds[i]);
+            }
+            count += bin_counts[i];
+            right_count[i] = count;
+            right_area[i] = count > 0 ? halfArea(sweep) : 0.0f;
+        }
+        float min_cost = FLT_MAX;
+        int split_bin = -1;
+        sweep = emptyBBox();
+        count = 0;
+        for(int i = 0; i < NUM_SAH_BINS - 1; i++)
+        {
+            if(bin_counts[i] > 0)
+            {
+                enlarge(sweep, bin_bounds[i]);
+            }
+            count += bin_counts[i];
+            if(count == 0 || right_count[i + 1] == 0)
+            {
+                continue;
+            }
+            float cost = halfArea(sweep) * count + right_area[i + 1] * right_count[i + 1];
+            if(cost < min_cost)
+            {
+                min_cost = cost;
+                split_bin = i;
+            }
+        }
+        if(split_bin == -1)
+        {
+            return begin;
+        }
+        BuildPrim* split = std::partition(&(prims[begin]), &(prims[0]) + end,
+                                          [=](const BuildPrim& p)
+                                          {
+                                              return (int)((p.centroid[axis] - axis_min) * bin_scale) <= split_bin;
+                                          });
+        return split - &(prims[0]);
+    }
+
+    std::vector<BVHNode> nodes;
+    std::vector<int> free_nodes;
+    std::vector<int> leaf_of_prim;      // Node index of each box's leaf, -1 if not in the tree
+    int root;
+    int max_depth;                      // Height of the root, the longest path a traversal can take
+    int built_depth;                    // max_depth right after the last build
+    int num_updates, num_built;
+};
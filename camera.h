@@ -2,6 +2,7 @@
 
 #include "mat.h"
 #include "imageplane.h"
+#include "frustum.h"
 #include "util.h"
 
 enum Direction
@@ -146,6 +147,12 @@ public:
         return camera_transform;
     }
 
+    // The camera doesn't own its projection, so pass the one it is drawn with
+    Frustum calcFrustum(const Mat4& proj_transform) const
+    {
+        return Frustum(proj_transform * view_transform);
+    }
+
     Vec3 getPosition() const
     {
         return pos;
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstring>
 
 #include "globaldata.h"
 #include "input.h"
@@ -13,8 +14,14 @@
 #include "translator.h"
 #include "selected.h"
 #include "track.h"
+#include "trackrenderer.h"
+#include "boxwireframedrawer.h"
+#include "frameuniforms.h"
+#include "glstate.h"
+#include "renderqueue.h"
+#include "rendertarget.h"
 #include "ship.h"
-#include "linegrid.h"
+#include "gridplane.h"
 #include "ray.h"
 
 extern GlobalData g;
@@ -41,12 +48,62 @@ enum EditorAction
     ZOOM
 };
 
+enum EditorView
+{
+    PERSPECTIVE_VIEW,
+    X_VIEW,
+    Y_VIEW,
+    Z_VIEW,
+    NUM_EDITOR_VIEWS
+};
+
+static const char* const EDITOR_VIEW_NAMES[NUM_EDITOR_VIEWS] = {"perspective", "x", "y", "z"};
+
+/*
+  The last image of an ortho view and everything it was drawn from
+  The ortho cameras rarely move while the perspective view is worked in, so a view
+  is only drawn again when its camera, the track, the selection or the ship changed.
+ */
+struct OrthoViewCache
+{
+    OrthoViewCache()
+        :track_revision(-1), selection_revision(-1)
+    {
+    }
+
+    bool isStale(const Mat4& view, const Mat4& proj, const Mat4& ship, const int track_rev, const int selection_rev) const
+    {
+        return track_rev != track_revision || selection_rev != selection_revision ||
+               !sameMat4(view, view_transform) || !sameMat4(proj, proj_transform) ||
+               !sameMat4(ship, ship_transform);
+    }
+
+    void store(const Mat4& view, const Mat4& proj, const Mat4& ship, const int track_rev, const int selection_rev)
+    {
+        view_transform = view;
+        proj_transform = proj;
+        ship_transform = ship;
+        track_revision = track_rev;
+        selection_revision = selection_rev;
+    }
+
+    static bool sameMat4(const Mat4& a, const Mat4& b)
+    {
+        return memcmp(&(a.data[0][0]), &(b.data[0][0]), sizeof(a.data)) == 0;
+    }
+
+    RenderTarget target;
+    Mat4 view_transform, proj_transform, ship_transform;
+    int track_revision, selection_revision;
+};
+
 class Editor
 {
 public:
-    Editor(Track& t, const Ship& s, const float a_r, const float fov, const Mat4 p_transform)
-        :track(t), ship(s), translator(p_transform), selected(t), bwfd(p_transform), aspect_ratio(a_r),
-        line_grid(GRID_UNIT, 0.0f, 500, p_transform)
+    Editor(Track& t, TrackRenderer& t_r, const Ship& s, FrameUniforms& f_u, const float a_r, const float fov,
+           const Mat4 p_transform)
+        :track(t), track_renderer(t_r), ship(s), frame_uniforms(f_u), selected(t), aspect_ratio(a_r),
+        grid_plane(GRID_UNIT, 500.0f)
     {
         pers_camera = PerspectiveCamera(Vec3(0.0f, 0.0f, -1.0f),
                              Vec3(0.0f, 1.0f, 0.0f), Vec3(0.0f, 1.0f, 4.0f), fov, aspect_ratio);
@@ -70,6 +127,11 @@ public:
         clicking_on_selected_box = false;
         click_to_move_box = false;
         last_active_key = nullptr;
+        num_ortho_redraws = 0;
+        for(int i = 0; i < NUM_EDITOR_VIEWS; i++)
+        {
+            view_cull_stats[i].num_visible = view_cull_stats[i].num_culled = 0;
+        }
     }
     void frame()
     {
@@ -290,6 +352,8 @@ public:
             std::string input_file_name;
             std::cout << "Input file name: ";
             std::cin >> input_file_name;
+            // The selected indices would point into the old track
+            selected.deselectAll();
             track.deleteBoxes();
             track.readFromFile(input_file_name.c_str());
         } break;   
@@ -414,49 +478,45 @@ public:
             break;
         }
 
+        // Upload this frame's box edits, selection and the ship's transform once for all views
+        track_renderer.update(track);
+        bwfd.update(selected);
+        ship.updateDynamicUniforms();
         if(!g.editor_multi_view)
         {
-            Mat4 view_transform = pers_camera.getViewTransform();
-            persViewDraw(view_transform);
+            persViewDraw(pers_camera.calcFrustum(pers_transform));
         }else
         {
             // bottom left
             glViewport(0, 0, g.window_width / 2, g.window_height / 2);
-            Mat4 view_transform = pers_camera.getViewTransform();
-            persViewDraw(view_transform);
+            persViewDraw(pers_camera.calcFrustum(pers_transform));
 
             // top left, x view
-            updateProjTransform(ortho_transform_x);
-            line_grid.setModelTransform(
-                //Mat4::makeTranslation(ortho_camera_x.getPosition() + Vec3(0.1f, 0.0f, 0.0f)) *
-                Mat4::makeZRotation(90.0f));
-            glViewport(0, g.window_height / 2, g.window_width / 2, g.window_height / 2);
-            view_transform = ortho_camera_x.getViewTransform();
-            orthoViewDraw(view_transform);
+            cachedOrthoViewDraw(ortho_camera_x, ortho_transform_x,
+                                //Mat4::makeTranslation(ortho_camera_x.getPosition() + Vec3(0.1f, 0.0f, 0.0f)) *
+                                Mat4::makeZRotation(90.0f),
+                                X_VIEW, 0, g.window_height / 2);
 
             // top right, y view
-            updateProjTransform(ortho_transform_y);
-            line_grid.setModelTransform(Mat4::makeTranslation(Vec3(0.0f, 8.0f, 0.0f)));
-            glViewport(g.window_width / 2, g.window_height / 2, g.window_width / 2, g.window_height / 2);
-            view_transform = ortho_camera_y.getViewTransform();
-            orthoViewDraw(view_transform);
+            cachedOrthoViewDraw(ortho_camera_y, ortho_transform_y, Mat4::makeTranslation(Vec3(0.0f, 8.0f, 0.0f)),
+                                Y_VIEW, g.window_width / 2, g.window_height / 2);
 
-            // top right, z view
-            updateProjTransform(ortho_transform_z);
-            line_grid.setModelTransform(
-                Mat4::makeXRotation(90.0f));
-
-            glViewport(g.window_width / 2, 0, g.window_width / 2, g.window_height / 2);
-            view_transform = ortho_camera_z.getViewTransform();
-            orthoViewDraw(view_transform);
+            // bottom right, z view
+            cachedOrthoViewDraw(ortho_camera_z, ortho_transform_z, Mat4::makeXRotation(90.0f),
+                                Z_VIEW, g.window_width / 2, 0);
 
             //printCameraLocations();
-            line_grid.setModelTransform(Mat4());
+            grid_plane.setModelTransform(Mat4());
             glViewport(0, 0, g.window_width, g.window_height);
-            updateProjTransform(pers_transform);
         }
     }
 
+    // For driving the editor from a script, like bench/framebench.cpp
+    PerspectiveCamera& getPerspectiveCamera()
+    {
+        return pers_camera;
+    }
+
     void printCameraLocations()
     {
         std::cout << "Camera locations\n";
@@ -466,65 +526,84 @@ public:
         ortho_camera_z.getPosition().print();
     }
 
+    // Boxes drawn and culled in the view the last time it was drawn
+    const CullStats& getCullStats(const EditorView view) const
+    {
+        return view_cull_stats[view];
+    }
+
+    void printCullStats()
+    {
+        std::cout << "Culling\n";
+        for(int i = 0; i < NUM_EDITOR_VIEWS; i++)
+        {
+            std::cout << EDITOR_VIEW_NAMES[i] << " visible " << view_cull_stats[i].num_visible
+                      << " culled " << view_cull_stats[i].num_culled << "\n";
+        }
+        std::cout << "Ortho views redrawn " << num_ortho_redraws << " times\n";
+    }
+
 private:
-    void persViewDraw(const Mat4& view_transform)
+    void persViewDraw(const Frustum& frustum)
     {
-        updateViewTransform(view_transform);
-        ship.draw();
-        track.draw();
-        glEnable(GL_BLEND);    
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        line_grid.draw();
-        glDisable(GL_BLEND);
+        updateFrameUniforms(pers_camera, pers_transform);
+        render_queue.begin(pers_camera.getPosition());
+        ship.submit(render_queue);
+        track_renderer.submit(render_queue, track, frustum);
+        view_cull_stats[PERSPECTIVE_VIEW] = track_renderer.getCullStats();
+        grid_plane.submit(render_queue);
         if(selected.getNumSelected()> 0)
         {
-            glDisable(GL_DEPTH_TEST);
-            for(int i = 0; i < selected.getNumSelected(); i++)
-            {
-                bwfd.drawWireframeOnBox(selected.getBox(i), view_transform);
-            }
+            bwfd.submit(render_queue);
             translator.moveTo(selected.getCenter());
-            translator.draw(view_transform);
-            glEnable(GL_DEPTH_TEST);
+            translator.submit(render_queue);
         }
+        render_queue.execute();
     }
 
-    void orthoViewDraw(const Mat4& view_transform)
+    // Draws the view into its render target if anything it shows changed, then
+    // copies the render target to the viewport at x, y
+    void cachedOrthoViewDraw(const OrthographicCamera& camera, const Mat4& proj_transform, const Mat4& grid_transform,
+                             const int view, const int x, const int y)
     {
-        updateViewTransform(view_transform);
-        ship.draw();
-        track.draw();
-        glEnable(GL_BLEND);    
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glDisable(GL_DEPTH_TEST);
-        line_grid.draw();
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
-        if(selected.getNumSelected()> 0)
+        OrthoViewCache& cache = ortho_view_caches[view - X_VIEW];
+        Mat4 view_transform = camera.getViewTransform();
+        bool resized = cache.target.resize(g.window_width / 2, g.window_height / 2);
+        if(resized || cache.isStale(view_transform, proj_transform, ship.transform, track.getRevision(),
+                                    selected.getRevision()))
         {
-            glDisable(GL_DEPTH_TEST);
-            for(int i = 0; i < selected.getNumSelected(); i++)
-            {
-                bwfd.drawWireframeOnBox(selected.getBox(i), view_transform);
-            }
-            glEnable(GL_DEPTH_TEST);
-        }        
+            cache.target.bind();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            updateFrameUniforms(camera, proj_transform);
+            grid_plane.setModelTransform(grid_transform);
+            orthoViewDraw(camera, camera.calcFrustum(proj_transform), view);
+            RenderTarget::unbind();
+            cache.store(view_transform, proj_transform, ship.transform, track.getRevision(), selected.getRevision());
+            num_ortho_redraws++;
+        }
+        cache.target.blitTo(x, y);
     }
 
-    void updateViewTransform(const Mat4& view_transform)
+    // Call updateFrameUniforms with the view's camera first
+    void orthoViewDraw(const Camera& camera, const Frustum& frustum, const int view)
     {
-        ship.updateDynamicUniforms(view_transform);
-        track.setViewTransform(view_transform);
-        line_grid.setViewTransform(view_transform);
+        render_queue.begin(camera.getPosition());
+        ship.submit(render_queue);
+        track_renderer.submit(render_queue, track, frustum);
+        view_cull_stats[view] = track_renderer.getCullStats();
+        grid_plane.submit(render_queue);
+        if(selected.getNumSelected()> 0)
+        {
+            bwfd.submit(render_queue);
+        }
+        render_queue.execute();
     }
 
-    void updateProjTransform(const Mat4& proj_transform)
+    // One uniform buffer update per view for every program
+    void updateFrameUniforms(const Camera& camera, const Mat4& proj_transform)
     {
-        ship.setProjTransform(proj_transform);
-        track.setProjTransform(proj_transform);
-        line_grid.setProjTransform(proj_transform);
-        translator.setProjTransform(proj_transform);
-        bwfd.setProjTransform(proj_transform);
+        frame_uniforms.setCamera(camera.getViewTransform(), proj_transform, camera.getPosition());
+        frame_uniforms.upload();
     }
 
     void calcActiveCamAndNewClickCoords(float& x, float& y)
@@ -575,10 +654,15 @@ private:
     Mat4 ortho_transform_z;
     Translator translator;
     Selected selected;
-    LineGrid line_grid;
+    GridPlane grid_plane;
     BoxWireframeDrawer bwfd;
+    RenderQueue render_queue;
+    OrthoViewCache ortho_view_caches[NUM_EDITOR_VIEWS - X_VIEW];
+    int num_ortho_redraws;
     Track& track;
+    TrackRenderer& track_renderer;
     const Ship& ship;
+    FrameUniforms& frame_uniforms;
     Camera* active_camera;
 
     int box_hit_side;
@@ -590,4 +674,5 @@ private:
     bool click_to_move_box;
     int* last_active_key;
     float aspect_ratio;
+    CullStats view_cull_stats[NUM_EDITOR_VIEWS];
 };
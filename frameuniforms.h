@@ -0,0 +1,94 @@
+#pragma once
+#include <cstring>
+#include <GL/glew.h>
+#include "mat.h"
+#include "vec.h"
+#include "glstate.h"
+#include "shaders/shader.h"
+
+/*
+  Camera and light data shared by every program, in one uniform buffer bound at
+  FRAME_UNIFORMS_BINDING. The shaders declare it as
+
+    layout(std140, row_major) uniform FrameUniforms
+    {
+        mat4 view_mat;
+        mat4 proj_mat;
+        vec4 dir_light;
+        vec4 camera_pos;
+    };
+
+  row_major matches Mat4, so matrices are copied as they are. Set the camera for
+  a view and call upload once, instead of setting uniforms in each program.
+ */
+class FrameUniforms
+{
+public:
+    FrameUniforms()
+        :dirty(true)
+    {
+        memset(&data, 0, sizeof(data));
+        glGenBuffers(1, &ubo);
+        g_gl_state.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(data), nullptr, GL_DYNAMIC_DRAW);
+        g_gl_state.bindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, ubo);
+    }
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    ~FrameUniforms()
+    {
+        g_gl_state.deleteBuffer(ubo);
+    }
+
+    void setCamera(const Mat4& view_transform, const Mat4& proj_transform, const Vec3& camera_pos)
+    {
+        memcpy(data.view_mat, &(view_transform.data[0][0]), sizeof(data.view_mat));
+        memcpy(data.proj_mat, &(proj_transform.data[0][0]), sizeof(data.proj_mat));
+        setVec4(data.camera_pos, camera_pos, 1.0f);
+        dirty = true;
+    }
+
+    void setDirLight(const Vec3& dir_light)
+    {
+        setVec4(data.dir_light, dir_light, 0.0f);
+        dirty = true;
+    }
+
+    // One buffer update for everything set since the last upload
+    void upload()
+    {
+        if(!dirty)
+        {
+            return;
+        }
+        g_gl_state.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+        dirty = false;
+    }
+
+private:
+    // std140: mat4 is 64 bytes, vec4 is 16, so the struct needs no padding
+    struct Data
+    {
+        GLfloat view_mat[16];
+        GLfloat proj_mat[16];
+        GLfloat dir_light[4];
+        GLfloat camera_pos[4];
+    };
+
+    static void setVec4(GLfloat* dst, const Vec3& v, const float w)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            dst[i] = v[i];
+        }
+        dst[3] = w;
+    }
+
+    Data data;
+    GLuint ubo;
+    bool dirty;
+};
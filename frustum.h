@@ -0,0 +1,107 @@
+#pragma once
+#include "mat.h"
+#include "bbox.h"
+
+/*
+  View frustum as six planes, extracted from a projection * view matrix with the
+  Gribb-Hartmann method. Works for perspective and orthographic projections.
+  Plane normals point into the frustum: a point p is inside plane i when
+  dot(planes[i].xyz, p) + planes[i].w >= 0.
+ */
+struct Frustum
+{
+    enum
+    {
+        OUTSIDE,
+        INTERSECTS,
+        INSIDE
+    };
+    static const unsigned int ALL_PLANES = (1 << 6) - 1;
+
+    Frustum()
+    {
+    }
+
+    // Mat4 is row major and multiplies column vectors, so clip = view_proj * p
+    // and each plane is the w row plus or minus the x, y or z row
+    explicit Frustum(const Mat4& view_proj)
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            for(int j = 0; j < 4; j++)
+            {
+                planes[i * 2][j] = view_proj.data[3][j] + view_proj.data[i][j];
+                planes[i * 2 + 1][j] = view_proj.data[3][j] - view_proj.data[i][j];
+            }
+        }
+        for(int i = 0; i < 6; i++)
+        {
+            float len = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+                              planes[i][2] * planes[i][2]);
+            if(len > 0.0f)
+            {
+                for(int j = 0; j < 4; j++)
+                {
+                    planes[i][j] /= len;
+                }
+            }
+        }
+    }
+
+    // Only the planes set in plane_mask are tested. Planes the bbox is completely
+    // inside of are cleared from plane_mask, so children of a bbox can skip them.
+    int classifyBBox(const BBox& bbox, unsigned int& plane_mask) const
+    {
+        int result = INSIDE;
+        for(int i = 0; i < 6; i++)
+        {
+            if(!(plane_mask & (1 << i)))
+            {
+                continue;
+            }
+            const Vec4& plane = planes[i];
+            // Corner furthest along the plane normal, and the one furthest against it
+            float far_dist = plane[3], near_dist = plane[3];
+            for(int j = 0; j < 3; j++)
+            {
+                if(plane[j] >= 0.0f)
+                {
+                    far_dist += plane[j] * bbox.max[j];
+                    near_dist += plane[j] * bbox.min[j];
+                }else
+                {
+                    far_dist += plane[j] * bbox.min[j];
+                    near_dist += plane[j] * bbox.max[j];
+                }
+            }
+            if(far_dist < 0.0f)
+            {
+                return OUTSIDE;
+            }
+            if(near_dist >= 0.0f)
+            {
+                plane_mask &= ~(1 << i);
+            }else
+            {
+                result = INTERSECTS;
+            }
+        }
+        return result;
+    }
+
+    bool bboxVisible(const BBox& bbox) const
+    {
+        unsigned int plane_mask = ALL_PLANES;
+        return classifyBBox(bbox, plane_mask) != OUTSIDE;
+    }
+
+    // Left, right, bottom, top, near, far
+    Vec4 planes[6];
+};
+
+// What one culled draw kept and dropped, in whatever units it culls
+struct CullStats
+{
+    int num_visible;
+    int num_culled;
+};
@@ -0,0 +1,260 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdio>
+
+struct GLStateStats
+{
+    int issued;
+    int elided;
+    int draws;
+};
+
+/*
+  Shadow copy of the GL state the renderer changes: program, vertex array, array and
+  uniform buffer bindings, texture units, blend and depth state. Each setter only
+  calls GL when the value differs from the cached one, so draw code binds what it
+  needs without unbinding afterwards.
+  Everything that changes this state has to go through g_gl_state, or call
+  invalidate afterwards. Delete objects with the delete functions here, GL unbinds
+  a deleted object and the cache has to know. Draw calls go through here too, so
+  they can be counted per frame.
+ */
+class GLState
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    GLState()
+    {
+        invalidate();
+        frame_stats.issued = frame_stats.elided = frame_stats.draws = 0;
+        last_frame_stats = frame_stats;
+    }
+
+    // Forget everything cached, the next call of each setter goes to GL
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertex_array = UNKNOWN;
+        array_buffer = UNKNOWN;
+        uniform_buffer = UNKNOWN;
+        active_texture = UNKNOWN;
+        for(int i = 0; i < MAX_TEXTURE_UNITS; i++)
+        {
+            textures_2d[i] = UNKNOWN;
+        }
+        blend = UNKNOWN_FLAG;
+        depth_test = UNKNOWN_FLAG;
+        depth_mask = UNKNOWN_FLAG;
+        blend_src = blend_dst = UNKNOWN;
+    }
+
+    void useProgram(const GLuint new_program)
+    {
+        if(changed(program, new_program))
+        {
+            glUseProgram(new_program);
+        }
+    }
+
+    void bindVertexArray(const GLuint new_vertex_array)
+    {
+        if(changed(vertex_array, new_vertex_array))
+        {
+            glBindVertexArray(new_vertex_array);
+        }
+    }
+
+    // GL_ELEMENT_ARRAY_BUFFER belongs to the bound vertex array, so it and other
+    // targets aren't cached
+    void bindBuffer(const GLenum target, const GLuint buffer)
+    {
+        GLuint* cached = nullptr;
+        if(target == GL_ARRAY_BUFFER)
+        {
+            cached = &array_buffer;
+        }else if(target == GL_UNIFORM_BUFFER)
+        {
+            cached = &uniform_buffer;
+        }
+        if(!cached)
+        {
+            frame_stats.issued++;
+            glBindBuffer(target, buffer);
+        }else if(changed(*cached, buffer))
+        {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    void activeTexture(const int unit)
+    {
+        if(changed(active_texture, (GLuint)(GL_TEXTURE0 + unit)))
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+    }
+
+    // Leaves unit as the active texture unit
+    void bindTexture2D(const int unit, const GLuint texture)
+    {
+        activeTexture(unit);
+        if(changed(textures_2d[unit], texture))
+        {
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+    }
+
+    void setBlend(const bool enable)
+    {
+        setCapability(blend, GL_BLEND, enable);
+    }
+
+    void blendFunc(const GLenum src, const GLenum dst)
+    {
+        if(blend_src == src && blend_dst == dst)
+        {
+            frame_stats.elided++;
+            return;
+        }
+        blend_src = src;
+        blend_dst = dst;
+        frame_stats.issued++;
+        glBlendFunc(src, dst);
+    }
+
+    void setDepthTest(const bool enable)
+    {
+        setCapability(depth_test, GL_DEPTH_TEST, enable);
+    }
+
+    void setDepthMask(const bool enable)
+    {
+        if(changed(depth_mask, enable ? 1 : 0))
+        {
+            glDepthMask(enable ? GL_TRUE : GL_FALSE);
+        }
+    }
+
+    void drawArrays(const GLenum mode, const GLint first, const GLsizei count)
+    {
+        frame_stats.draws++;
+        glDrawArrays(mode, first, count);
+    }
+
+    void drawArraysInstanced(const GLenum mode, const GLint first, const GLsizei count, const GLsizei num_instances)
+    {
+        frame_stats.draws++;
+        glDrawArraysInstanced(mode, first, count, num_instances);
+    }
+
+    void drawElements(const GLenum mode, const GLsizei count, const GLenum type, const void* indices)
+    {
+        frame_stats.draws++;
+        glDrawElements(mode, count, type, indices);
+    }
+
+    void deleteBuffer(const GLuint buffer)
+    {
+        forget(array_buffer, buffer);
+        forget(uniform_buffer, buffer);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void deleteVertexArray(const GLuint deleted_vertex_array)
+    {
+        forget(vertex_array, deleted_vertex_array);
+        glDeleteVertexArrays(1, &deleted_vertex_array);
+    }
+
+    void deleteTexture(const GLuint texture)
+    {
+        for(int i = 0; i < MAX_TEXTURE_UNITS; i++)
+        {
+            forget(textures_2d[i], texture);
+        }
+        glDeleteTextures(1, &texture);
+    }
+
+    void deleteProgram(const GLuint deleted_program)
+    {
+        forget(program, deleted_program);
+        glDeleteProgram(deleted_program);
+    }
+
+    // Call once per frame, after the last draw
+    void endFrame()
+    {
+        last_frame_stats = frame_stats;
+        frame_stats.issued = frame_stats.elided = frame_stats.draws = 0;
+    }
+
+    GLStateStats getLastFrameStats() const
+    {
+        return last_frame_stats;
+    }
+
+    void printLastFrameStats() const
+    {
+        int total = last_frame_stats.issued + last_frame_stats.elided;
+        printf("GL state calls issued %d elided %d (%.1f%% elided), %d draw calls\n", last_frame_stats.issued,
+               last_frame_stats.elided, total > 0 ? 100.0f * last_frame_stats.elided / total : 0.0f,
+               last_frame_stats.draws);
+    }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+    static const int UNKNOWN_FLAG = -1;
+
+    // Updates cached and counts the call, returns whether GL has to be called
+    template<typename T>
+    bool changed(T& cached, const T value)
+    {
+        if(cached == value)
+        {
+            frame_stats.elided++;
+            return false;
+        }
+        cached = value;
+        frame_stats.issued++;
+        return true;
+    }
+
+    void setCapability(int& cached, const GLenum capability, const bool enable)
+    {
+        if(changed(cached, enable ? 1 : 0))
+        {
+            if(enable)
+            {
+                glEnable(capability);
+            }else
+            {
+                glDisable(capability);
+            }
+        }
+    }
+
+    static void forget(GLuint& cached, const GLuint deleted)
+    {
+        if(cached == deleted)
+        {
+            cached = UNKNOWN;
+        }
+    }
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint array_buffer;
+    GLuint uniform_buffer;
+    GLuint active_texture;
+    GLuint textures_2d[MAX_TEXTURE_UNITS];
+    int blend;
+    int depth_test;
+    int depth_mask;
+    GLenum blend_src, blend_dst;
+    GLStateStats frame_stats;
+    GLStateStats last_frame_stats;
+};
+
+// Defined in main.cpp
+extern GLState g_gl_state;
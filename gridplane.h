@@ -0,0 +1,69 @@
+#pragma once
+#include <GL/glew.h>
+#include "mat.h"
+#include "vec.h"
+#include "glstate.h"
+#include "renderqueue.h"
+#include "shaders/shaderregistry.h"
+
+/*
+  An endless grid of lines in the xz plane of its model transform
+  grid.vs makes one quad from gl_VertexID, centered under the camera, and grid.fs
+  computes the lines from the position on the plane, anti-aliased with fwidth and
+  faded out with distance to the camera. So there is no vertex buffer, only an
+  empty vertex array, which core profiles need bound to draw.
+ */
+class GridPlane
+{
+public:
+    GridPlane(const float spacing, const float extent)
+        :spacing(spacing), extent(extent), color(0.7f, 1.0f, 0.0f)
+    {
+        glGenVertexArrays(1, &vao);
+        shader_program = g_shaders.getProgram("shaders/grid.vs", "shaders/grid.fs");
+        u_model_mat = g_shaders.getUniform<Mat4>(shader_program, "model_mat");
+        u_color = g_shaders.getUniform<Vec3>(shader_program, "color");
+        u_spacing = g_shaders.getUniform<float>(shader_program, "spacing");
+        u_extent = g_shaders.getUniform<float>(shader_program, "extent");
+    }
+
+    GridPlane(const GridPlane&) = delete;
+    GridPlane& operator=(const GridPlane&) = delete;
+
+    ~GridPlane()
+    {
+        g_gl_state.deleteVertexArray(vao);
+    }
+
+    void setModelTransform(const Mat4& model_transform)
+    {
+        this->model_transform = model_transform;
+    }
+
+    // Blended, so it goes in the transparent pass
+    void submit(RenderQueue& queue) const
+    {
+        float depth = queue.calcDepth(Vec3(model_transform.getColumn(3)));
+        queue.submit(PASS_TRANSPARENT, shader_program, vao, 0, depth, drawQuad, this);
+    }
+
+private:
+    static void drawQuad(const DrawItem& item)
+    {
+        const GridPlane& grid = *(const GridPlane*)item.object;
+        setUniform(grid.u_model_mat, grid.model_transform);
+        setUniform(grid.u_color, grid.color);
+        setUniform(grid.u_spacing, grid.spacing);
+        setUniform(grid.u_extent, grid.extent);
+        g_gl_state.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
+
+    GLuint vao, shader_program;
+    Uniform<Mat4> u_model_mat;
+    Uniform<Vec3> u_color;
+    Uniform<float> u_spacing, u_extent;
+    float spacing;
+    float extent;
+    Vec3 color;
+    Mat4 model_transform;
+};
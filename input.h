@@ -21,6 +21,7 @@ struct Input
     int left_ctrl;
 
     bool jump_request;
+    bool print_cull_stats_request;
 
     // Mouse
     double left_click_x;
@@ -51,6 +52,7 @@ struct Input
         h = 0;
         left_ctrl = 0;
         jump_request = false;
+        print_cull_stats_request = false;
         left_click_x = 0;
         left_click_y = 0;
         right_click_x = 0;
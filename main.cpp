@@ -22,8 +22,14 @@
 #include "box.h"
 #include "camera.h"
 #include "track.h"
+#include "trackrenderer.h"
+#include "trackmesher.h"
+#include "frameuniforms.h"
+#include "shaders/shaderregistry.h"
+#include "glstate.h"
+#include "streambuffer.h"
+#include "renderqueue.h"
 #include "globalclock.h"
-#include "linegrid.h"
 #include "globaldata.h"
 #include "input.h"
 #include "editor.h"
@@ -32,6 +38,9 @@ bool EXIT = false;
 
 GlobalData g;
 Input g_input;
+ShaderRegistry g_shaders;
+GLState g_gl_state;
+StreamBuffer g_stream_buffer;
 
 void calcShipAccelState(int accel_states[3], Input& input)
 {    
@@ -243,6 +252,7 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
         case GLFW_KEY_G:
         {
             g_input.g = 0;
+            g_gl_state.printLastFrameStats();
         } break;
         case GLFW_KEY_P:
         {
@@ -252,6 +262,10 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
         {
             g_input.h = 0;
             g.editor_multi_view = !g.editor_multi_view;
+        } break;
+        case GLFW_KEY_V:
+        {
+            g_input.print_cull_stats_request = true;
         } break;                        
         case GLFW_KEY_LEFT_CONTROL:
         {
@@ -313,7 +327,8 @@ void getNormalizedWindowCoord(float& x, float& y, const unsigned int x_pos, cons
     y = (float)(y_pos - g.window_height/2.0f) / (g.window_height / 2.0f);
 }
 
-void gameModeFrame(PerspectiveCamera& camera, Ship& ship, Track& track)
+void gameModeFrame(PerspectiveCamera& camera, const Mat4& proj_transform, Ship& ship, Track& track,
+                   TrackMesh& track_mesh, FrameUniforms& frame_uniforms, RenderQueue& render_queue)
 {
     // Update ship position and velocity based on velocity from last frame
     // Update ship velocity based on keyboard input
@@ -336,11 +351,15 @@ void gameModeFrame(PerspectiveCamera& camera, Ship& ship, Track& track)
     ship.updatePosAndVelocity(g.dt, track);
     camera.setPosRelativeToShip(ship);
 
-    Mat4 view_transform = camera.getViewTransform();
-    ship.updateDynamicUniforms(view_transform);
-    ship.draw();
-    track.setViewTransform(view_transform);
-    track.draw();
+    frame_uniforms.setCamera(camera.getViewTransform(), proj_transform, camera.getPosition());
+    frame_uniforms.upload();
+    ship.updateDynamicUniforms();
+    // The track can't be edited while playing, so it is drawn as a merged static mesh
+    track_mesh.update(track);
+    render_queue.begin(camera.getPosition());
+    ship.submit(render_queue);
+    track_mesh.submit(render_queue, camera.calcFrustum(proj_transform));
+    render_queue.execute();
 }
 
 
@@ -353,9 +372,9 @@ GLFWwindow* initWindow(unsigned int width, unsigned int height)
 		//return -1;
 	}
 
-	// Create a rendering window with OpenGL 3.2 context
+	// Create a rendering window with OpenGL 3.3 context, for glVertexAttribDivisor
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
@@ -436,22 +455,23 @@ int main()
     // Ship transforms
     //Mat4 ship_normal_transform = ((view_transform * model.inverse())).transpose();
     Ship ship;
-    ship.setStaticUniforms(proj_transform, dir_light);
+    ship.setStaticUniforms();
     ship.move(Vec3(0.0f, 2.0f, 0.0f));
 
-    // Box transforms
-    Mat4 transform = view_transform;
-    Mat4 normal_transform = (transform.inverse()).transpose();
+    // Camera and light for every program
+    FrameUniforms frame_uniforms;
+    frame_uniforms.setCamera(view_transform, proj_transform, pers_camera.getPosition());
+    frame_uniforms.setDirLight(dir_light);
+    frame_uniforms.upload();
+    // Collects each view's draws and executes them sorted by state and depth
+    RenderQueue render_queue;
 
     // Track stuff
     Track track;
-    track.setUniforms(transform, normal_transform, proj_transform, dir_light);
     track.readFromFile("track1.txt");
-    
-    // Line grid
-    // TODO
-    //LineGrid line_grid(1.0f, 0.0f, 500, view_transform, proj_transform);
-    LineGrid line_grid(1.0f, 0.0f, 500, proj_transform);
+    TrackRenderer track_renderer;
+    // Play mode draws the track merged into one static mesh instead
+    TrackMesh track_mesh;
 
     // IMGUI stuff
     bool show_test_window = true;
@@ -464,9 +484,9 @@ int main()
 
     GlobalClock gclock;
 
-    Editor editor(track, ship, aspect_ratio, fov, proj_transform);
+    Editor editor(track, track_renderer, ship, frame_uniforms, aspect_ratio, fov, proj_transform);
 
-    glEnable(GL_DEPTH_TEST);
+    g_gl_state.setDepthTest(true);
     int count = 0;
 	while (!glfwWindowShouldClose(window) && !EXIT)
 	{
@@ -503,17 +523,32 @@ int main()
             editor.frame();
         }else if(g.game_mode == PLAY)
         {
-            gameModeFrame(pers_camera, ship, track);
+            gameModeFrame(pers_camera, proj_transform, ship, track, track_mesh, frame_uniforms, render_queue);
+        }
+        if(g_input.print_cull_stats_request)
+        {
+            if(g.game_mode == EDITOR)
+            {
+                editor.printCullStats();
+            }else if(g.game_mode == PLAY)
+            {
+                track_mesh.printStats();
+            }
+            g_input.print_cull_stats_request = false;
         }
 
         //last_cursor_x = cursor_x;
         //last_cursor_y = cursor_y;        
         //ImGui::Render();
         g_input.resetSomeFlags();
+        g_stream_buffer.endFrame();
+        g_gl_state.endFrame();
 		glfwSwapBuffers(window); // Takes about 0.017 sec or 1/60 sec
 	}
 
     //ImGui_ImplGlfwGL3_Shutdown();
+    g_stream_buffer.destroy();
+    g_shaders.deleteAll();
 	glfwTerminate();
 	return 0;
 }
@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define MAPPED_FILE_USE_READ 1
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+  Read only view of a whole file
+  Uses mmap where available, so opening a big file costs nothing until its pages
+  are touched. On Windows the file is read into a malloc'd buffer instead.
+ */
+class MappedFile
+{
+public:
+    MappedFile()
+        :data(nullptr), size(0)
+    {
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    bool open(const char* file_name)
+    {
+        close();
+#ifdef MAPPED_FILE_USE_READ
+        FILE* file = fopen(file_name, "rb");
+        if(!file)
+        {
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        long file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if(file_size <= 0)
+        {
+            fclose(file);
+            return file_size == 0;
+        }
+        char* buffer = (char*)malloc(file_size);
+        if(!buffer || fread(buffer, 1, file_size, file) != (size_t)file_size)
+        {
+            free(buffer);
+            fclose(file);
+            return false;
+        }
+        fclose(file);
+        data = buffer;
+        size = file_size;
+        return true;
+#else
+        int fd = ::open(file_name, O_RDONLY);
+        if(fd == -1)
+        {
+            return false;
+        }
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        if(file_stat.st_size == 0)
+        {
+            // mmap can't map an empty file
+            ::close(fd);
+            return true;
+        }
+        void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        data = (const char*)mapping;
+        size = file_stat.st_size;
+        return true;
+#endif
+    }
+
+    void close()
+    {
+        if(data)
+        {
+#ifdef MAPPED_FILE_USE_READ
+            free((void*)data);
+#else
+            munmap((void*)data, size);
+#endif
+        }
+        data = nullptr;
+        size = 0;
+    }
+
+    const char* getData() const
+    {
+        return data;
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    const char* data;
+    size_t size;
+};
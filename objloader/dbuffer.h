@@ -15,6 +15,20 @@ typedef struct
 
 #define DBuffer_size(a) ((a).size) / ((a).element_size)
 #define DBuffer_max_elements(a) ((a).max) / ((a).element_size)
+// Empties it and keeps the memory for reuse
+#define DBuffer_clear(a) ((a).size = 0)
+
+// Counts of the heap allocations of all DBuffers, for measuring the loader
+typedef struct
+{
+    long long num_allocs;   // mallocs and reallocs
+    long long bytes;        // Capacity currently allocated
+    long long peak_bytes;
+}DBufferStats;
+
+extern DBufferStats g_dbuffer_stats;
+
+void DBuffer_reset_stats();
 
 void DBuffer_push_f(DBuffer* dbuf, const char* new_element, const size_t element_size);
 #define DBuffer_push(a, b) DBuffer_push_f((&(a)), (const char*)(&b), sizeof(b))
@@ -32,14 +46,34 @@ void* DBuffer_data_ptr_f(DBuffer* dbuf);
 void DBuffer_destroy(DBuffer* dbuf);
 
 #ifdef OBJ_LOADER_IMPLEMENTATION    
+DBufferStats g_dbuffer_stats = {0, 0, 0};
+
+static void DBuffer_count_alloc(const long long old_max, const long long new_max)
+{
+    g_dbuffer_stats.num_allocs++;
+    g_dbuffer_stats.bytes += new_max - old_max;
+    if(g_dbuffer_stats.bytes > g_dbuffer_stats.peak_bytes)
+    {
+        g_dbuffer_stats.peak_bytes = g_dbuffer_stats.bytes;
+    }
+}
+
+void DBuffer_reset_stats()
+{
+    g_dbuffer_stats.num_allocs = 0;
+    g_dbuffer_stats.bytes = 0;
+    g_dbuffer_stats.peak_bytes = 0;
+}
+
 void DBuffer_push_f(DBuffer* dbuf, const char* new_element, const size_t element_size)
 {
     if(dbuf->size + element_size > (unsigned)dbuf->max)
     {
-        int new_max = dbuf->max * 2;
+        int new_max = dbuf->max > 0 ? dbuf->max * 2 : (int)element_size * DEFAULT_INITIAL_CAPACITY;
         char* new_data = (char*)realloc(dbuf->data, new_max);
         if(new_data)
         {
+            DBuffer_count_alloc(dbuf->max, new_max);
             dbuf->data = new_data;
             dbuf->max = new_max;
         }else
@@ -61,6 +95,7 @@ DBuffer DBuffer_create_f(const int element_size)
     DBuffer dbuf;
     dbuf.data = (char*)malloc(element_size * DEFAULT_INITIAL_CAPACITY);
     dbuf.max = element_size * DEFAULT_INITIAL_CAPACITY;
+    DBuffer_count_alloc(0, dbuf.max);
     dbuf.size = 0;
     dbuf.element_size = element_size;
     return dbuf;
@@ -71,6 +106,7 @@ DBuffer DBuffer_create_cap_f(const int element_size, const int max_elements)
     DBuffer dbuf;
     dbuf.data = (char*)malloc(element_size * max_elements);
     dbuf.max = element_size * max_elements;
+    DBuffer_count_alloc(0, dbuf.max);
     dbuf.size = 0;
     dbuf.element_size = element_size;
     return dbuf;    
@@ -101,6 +137,8 @@ void* DBuffer_data_ptr_f(DBuffer *dbuf)
 void DBuffer_destroy(DBuffer* dbuf)
 {
     if(dbuf->data){free(dbuf->data);}
+    g_dbuffer_stats.bytes -= dbuf->max;
+    dbuf->data = NULL;
     dbuf->max = 0;
     dbuf->size = 0;
     dbuf->element_size = 0;
@@ -0,0 +1,351 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+  Decimal text to float conversion for the OBJ and MTL loaders
+  Correctly rounded like strtof, but it ignores the locale and needs no terminating
+  '\0', so it parses numbers where they lie in a mapped file. Up to 19 significant
+  digits go into a 64 bit integer w and the number is w * 10^q. Small enough w and q
+  are exact in float and take one multiply or divide (Clinger's fast path), the rest
+  are rounded from the upper bits of w times a 128 bit 5^q (Eisel-Lemire, as in
+  Lemire's fast_float). Numbers with more digits are rounded with w and w + 1, and
+  only when those disagree, or for inf and nan, it falls back to strtof.
+ */
+
+// Below this a 19 digit w rounds to zero, above it to infinity
+const int FAST_FLOAT_MIN_POW10 = -65;
+const int FAST_FLOAT_MAX_POW10 = 38;
+const int FAST_FLOAT_MAX_DIGITS = 19;
+const int FAST_FLOAT_MANTISSA_BITS = 23;
+const uint32_t FAST_FLOAT_INFINITY = 0x7F800000;
+
+// 5^q for q from FAST_FLOAT_MIN_POW10 to FAST_FLOAT_MAX_POW10, as the upper and lower
+// 64 bits of a 128 bit value shifted so its top bit is set. Negative powers are rounded up.
+static const uint64_t FastFloat_pow5[] = {
+    0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull,    // 5^-65
+    0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull,    // 5^-64
+    0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,    // 5^-63
+    0x83a3eeeef9153e89ull, 0x1953cf68300424acull,    // 5^-62
+    0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,    // 5^-61
+    0xcdb02555653131b6ull, 0x3792f412cb06794dull,    // 5^-60
+    0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,    // 5^-59
+    0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull,    // 5^-58
+    0xc8de047564d20a8bull, 0xf245825a5a445275ull,    // 5^-57
+    0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull,    // 5^-56
+    0x9ced737bb6c4183dull, 0x55464dd69685606bull,    // 5^-55
+    0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull,    // 5^-54
+    0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,    // 5^-53
+    0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull,    // 5^-52
+    0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,    // 5^-51
+    0xef73d256a5c0f77cull, 0x963e66858f6d4440ull,    // 5^-50
+    0x95a8637627989aadull, 0xdde7001379a44aa8ull,    // 5^-49
+    0xbb127c53b17ec159ull, 0x5560c018580d5d52ull,    // 5^-48
+    0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,    // 5^-47
+    0x9226712162ab070dull, 0xcab3961304ca70e8ull,    // 5^-46
+    0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,    // 5^-45
+    0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull,    // 5^-44
+    0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,    // 5^-43
+    0xb267ed1940f1c61cull, 0x55f038b237591ed3ull,    // 5^-42
+    0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,    // 5^-41
+    0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull,    // 5^-40
+    0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,    // 5^-39
+    0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull,    // 5^-38
+    0x881cea14545c7575ull, 0x7e50d64177da2e54ull,    // 5^-37
+    0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull,    // 5^-36
+    0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,    // 5^-35
+    0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull,    // 5^-34
+    0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,    // 5^-33
+    0xcfb11ead453994baull, 0x67de18eda5814af2ull,    // 5^-32
+    0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,    // 5^-31
+    0xa2425ff75e14fc31ull, 0xa1258379a94d028dull,    // 5^-30
+    0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,    // 5^-29
+    0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull,    // 5^-28
+    0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,    // 5^-27
+    0xc612062576589ddaull, 0x95364afe032a819eull,    // 5^-26
+    0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,    // 5^-25
+    0x9abe14cd44753b52ull, 0xc4926a9672793543ull,    // 5^-24
+    0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,    // 5^-23
+    0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull,    // 5^-22
+    0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,    // 5^-21
+    0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull,    // 5^-20
+    0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,    // 5^-19
+    0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull,    // 5^-18
+    0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,    // 5^-17
+    0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull,    // 5^-16
+    0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,    // 5^-15
+    0xb424dc35095cd80full, 0x538484c19ef38c95ull,    // 5^-14
+    0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,    // 5^-13
+    0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull,    // 5^-12
+    0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,    // 5^-11
+    0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull,    // 5^-10
+    0x89705f4136b4a597ull, 0x31680a88f8953031ull,    // 5^-9
+    0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull,    // 5^-8
+    0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,    // 5^-7
+    0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull,    // 5^-6
+    0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,    // 5^-5
+    0xd1b71758e219652bull, 0xd3c36113404ea4a9ull,    // 5^-4
+    0x83126e978d4fdf3bull, 0x645a1cac083126eaull,    // 5^-3
+    0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull,    // 5^-2
+    0xccccccccccccccccull, 0xcccccccccccccccdull,    // 5^-1
+    0x8000000000000000ull, 0x0000000000000000ull,    // 5^0
+    0xa000000000000000ull, 0x0000000000000000ull,    // 5^1
+    0xc800000000000000ull, 0x0000000000000000ull,    // 5^2
+    0xfa00000000000000ull, 0x0000000000000000ull,    // 5^3
+    0x9c40000000000000ull, 0x0000000000000000ull,    // 5^4
+    0xc350000000000000ull, 0x0000000000000000ull,    // 5^5
+    0xf424000000000000ull, 0x0000000000000000ull,    // 5^6
+    0x9896800000000000ull, 0x0000000000000000ull,    // 5^7
+    0xbebc200000000000ull, 0x0000000000000000ull,    // 5^8
+    0xee6b280000000000ull, 0x0000000000000000ull,    // 5^9
+    0x9502f90000000000ull, 0x0000000000000000ull,    // 5^10
+    0xba43b74000000000ull, 0x0000000000000000ull,    // 5^11
+    0xe8d4a51000000000ull, 0x0000000000000000ull,    // 5^12
+    0x9184e72a00000000ull, 0x0000000000000000ull,    // 5^13
+    0xb5e620f480000000ull, 0x0000000000000000ull,    // 5^14
+    0xe35fa931a0000000ull, 0x0000000000000000ull,    // 5^15
+    0x8e1bc9bf04000000ull, 0x0000000000000000ull,    // 5^16
+    0xb1a2bc2ec5000000ull, 0x0000000000000000ull,    // 5^17
+    0xde0b6b3a76400000ull, 0x0000000000000000ull,    // 5^18
+    0x8ac7230489e80000ull, 0x0000000000000000ull,    // 5^19
+    0xad78ebc5ac620000ull, 0x0000000000000000ull,    // 5^20
+    0xd8d726b7177a8000ull, 0x0000000000000000ull,    // 5^21
+    0x878678326eac9000ull, 0x0000000000000000ull,    // 5^22
+    0xa968163f0a57b400ull, 0x0000000000000000ull,    // 5^23
+    0xd3c21bcecceda100ull, 0x0000000000000000ull,    // 5^24
+    0x84595161401484a0ull, 0x0000000000000000ull,    // 5^25
+    0xa56fa5b99019a5c8ull, 0x0000000000000000ull,    // 5^26
+    0xcecb8f27f4200f3aull, 0x0000000000000000ull,    // 5^27
+    0x813f3978f8940984ull, 0x4000000000000000ull,    // 5^28
+    0xa18f07d736b90be5ull, 0x5000000000000000ull,    // 5^29
+    0xc9f2c9cd04674edeull, 0xa400000000000000ull,    // 5^30
+    0xfc6f7c4045812296ull, 0x4d00000000000000ull,    // 5^31
+    0x9dc5ada82b70b59dull, 0xf020000000000000ull,    // 5^32
+    0xc5371912364ce305ull, 0x6c28000000000000ull,    // 5^33
+    0xf684df56c3e01bc6ull, 0xc732000000000000ull,    // 5^34
+    0x9a130b963a6c115cull, 0x3c7f400000000000ull,    // 5^35
+    0xc097ce7bc90715b3ull, 0x4b9f100000000000ull,    // 5^36
+    0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,    // 5^37
+    0x96769950b50d88f4ull, 0x1314448000000000ull     // 5^38
+};
+
+// Exactly representable in float, for the fast path
+static const float FastFloat_pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+// x can't be 0
+static inline int FastFloat_countLeadingZeros(const uint64_t x)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, x);
+    return 63 - (int)index;
+#else
+    return __builtin_clzll(x);
+#endif
+}
+
+// Returns the lower 64 bits of a * b and sets high to the upper ones
+static inline uint64_t FastFloat_multiply(const uint64_t a, const uint64_t b, uint64_t* high)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    *high = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, high);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    *high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    return (cross << 32) | (uint32_t)lo_lo;
+#endif
+}
+
+// The bits of the positive float closest to w * 10^q
+static inline uint32_t FastFloat_eiselLemire(const int q, uint64_t w)
+{
+    if(w == 0 || q < FAST_FLOAT_MIN_POW10)
+    {
+        return 0;
+    }
+    if(q > FAST_FLOAT_MAX_POW10)
+    {
+        return FAST_FLOAT_INFINITY;
+    }
+    int leading_zeros = FastFloat_countLeadingZeros(w);
+    w <<= leading_zeros;
+
+    // The mantissa, a rounding bit and one more for the top bit of the product are
+    // 26 bits. Only when all the bits below them are set can the lower half of 5^q
+    // carry into them.
+    const uint64_t* pow5 = &(FastFloat_pow5[2 * (q - FAST_FLOAT_MIN_POW10)]);
+    uint64_t high;
+    uint64_t low = FastFloat_multiply(w, pow5[0], &high);
+    const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFull >> (FAST_FLOAT_MANTISSA_BITS + 3);
+    if((high & precision_mask) == precision_mask)
+    {
+        uint64_t second_high;
+        FastFloat_multiply(w, pow5[1], &second_high);
+        low += second_high;
+        if(second_high > low)
+        {
+            high++;
+        }
+    }
+
+    int upper_bit = (int)(high >> 63);
+    int shift = upper_bit + 64 - FAST_FLOAT_MANTISSA_BITS - 3;
+    uint64_t mantissa = high >> shift;
+    // floor(q * log2(10)) + 63, plus the float exponent bias
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - leading_zeros + 127;
+    if(power2 <= 0)
+    {
+        // Subnormal
+        if(-power2 + 1 >= 64)
+        {
+            return 0;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        // Rounding up can make it the smallest normal float, the mantissa bit 23 is then the exponent 1
+        return (uint32_t)mantissa;
+    }
+    // Exactly halfway between two floats only happens for small q, round to even
+    if(low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1 && (mantissa << shift) == high)
+    {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (2ull << FAST_FLOAT_MANTISSA_BITS))
+    {
+        mantissa = 1ull << FAST_FLOAT_MANTISSA_BITS;
+        power2++;
+    }
+    mantissa &= ~(1ull << FAST_FLOAT_MANTISSA_BITS);
+    if(power2 >= 0xFF)
+    {
+        return FAST_FLOAT_INFINITY;
+    }
+    return (uint32_t)mantissa | ((uint32_t)power2 << FAST_FLOAT_MANTISSA_BITS);
+}
+
+static inline const char* FastFloat_parseFallback(const char* str, const char* end, float* value)
+{
+    char buffer[128];
+    int length = 0;
+    while(str + length < end && length < (int)sizeof(buffer) - 1 && str[length] != ' ' && str[length] != '\t' &&
+          str[length] != '\r' && str[length] != '\n')
+    {
+        length++;
+    }
+    memcpy(buffer, str, length);
+    buffer[length] = '\0';
+    char* number_end;
+    *value = strtof(buffer, &number_end);
+    return str + (number_end - buffer);
+}
+
+// Parses the number at str like strtof and returns its end, or str if there is none
+static inline const char* FastFloat_parse(const char* str, const char* end, float* value)
+{
+    const char* ptr = str;
+    bool negative = false;
+    if(ptr < end && (*ptr == '-' || *ptr == '+'))
+    {
+        negative = *ptr == '-';
+        ptr++;
+    }
+    // Leading zeros are not significant digits, w stays 0 until the first other one
+    uint64_t w = 0;
+    int q = 0;
+    int num_digits = 0;
+    bool any_digits = false;
+    bool truncated = false;
+    while(ptr < end && (unsigned)(*ptr - '0') < 10)
+    {
+        if(num_digits < FAST_FLOAT_MAX_DIGITS)
+        {
+            w = w * 10 + (*ptr - '0');
+            num_digits += w != 0;
+        }else
+        {
+            q++;
+            truncated |= *ptr != '0';
+        }
+        any_digits = true;
+        ptr++;
+    }
+    if(ptr < end && *ptr == '.')
+    {
+        ptr++;
+        while(ptr < end && (unsigned)(*ptr - '0') < 10)
+        {
+            if(num_digits < FAST_FLOAT_MAX_DIGITS)
+            {
+                w = w * 10 + (*ptr - '0');
+                num_digits += w != 0;
+                q--;
+            }else
+            {
+                truncated |= *ptr != '0';
+            }
+            any_digits = true;
+            ptr++;
+        }
+    }
+    if(!any_digits)
+    {
+        // inf, nan or not a number at all
+        return FastFloat_parseFallback(str, end, value);
+    }
+    if(ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        const char* exponent_ptr = ptr + 1;
+        bool negative_exponent = false;
+        if(exponent_ptr < end && (*exponent_ptr == '-' || *exponent_ptr == '+'))
+        {
+            negative_exponent = *exponent_ptr == '-';
+            exponent_ptr++;
+        }
+        // Without digits the 'e' isn't part of the number
+        if(exponent_ptr < end && (unsigned)(*exponent_ptr - '0') < 10)
+        {
+            int exponent = 0;
+            while(exponent_ptr < end && (unsigned)(*exponent_ptr - '0') < 10)
+            {
+                if(exponent < 100000)
+                {
+                    exponent = exponent * 10 + (*exponent_ptr - '0');
+                }
+                exponent_ptr++;
+            }
+            q += negative_exponent ? -exponent : exponent;
+            ptr = exponent_ptr;
+        }
+    }
+
+    if(!truncated && q >= -10 && q <= 10 && w <= (1ull << (FAST_FLOAT_MANTISSA_BITS + 1)))
+    {
+        float r = (float)w;
+        r = q < 0 ? r / FastFloat_pow10[-q] : r * FastFloat_pow10[q];
+        *value = negative ? -r : r;
+        return ptr;
+    }
+    uint32_t bits = FastFloat_eiselLemire(q, w);
+    // The dropped digits put the number between w and w + 1
+    if(truncated && bits != FastFloat_eiselLemire(q, w + 1))
+    {
+        return FastFloat_parseFallback(str, end, value);
+    }
+    bits |= negative ? 0x80000000u : 0;
+    memcpy(value, &bits, sizeof(bits));
+    return ptr;
+}
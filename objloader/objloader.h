@@ -5,7 +5,9 @@
 #include <string.h>
 #include <assert.h>
 #include "dbuffer.h"
-#include "hashindex.h"
+#include "vertexhash.h"
+#include "fastfloat.h"
+#include "../mappedfile.h"
 
 #define OBJ_NAME_LENGTH 64
 #define OBJ_PATH_LENGTH 128
@@ -127,65 +129,111 @@ typedef struct VertexIndex_s
     int v_idx, vn_idx, vt_idx;
 }VertexIndex;
 
-static bool OBJGetLine(FILE* fp, int* read_result, char buffer[], const int buffer_size)
+// A face's corners in the VertexIndex array of its group
+typedef struct OBJFace_s
 {
-    bool not_end_of_file = true;
-    bool reading = true;
-    int index = 0;
-    while(reading)
+    int first_corner;
+    int num_corners;
+}OBJFace;
+
+/*
+  The loaders map the whole file and parse each line where it lies, so there is no
+  per-line copy and no limit on the line length. Lines are bounded by an end pointer
+  instead of a terminating '\0', every parse function below takes the end of the line
+  and never reads past it.
+ */
+
+// Returns the start of the line after the one at ptr and sets line_end to the end of
+// the one at ptr, without its "\n" or "\r\n"
+static inline const char* OBJNextLine(const char* ptr, const char* end, const char** line_end)
+{
+    const char* newline = (const char*)memchr(ptr, '\n', end - ptr);
+    const char* next = newline ? newline + 1 : end;
+    const char* last = newline ? newline : end;
+    if(last > ptr && last[-1] == '\r')
     {
-        char c = fgetc(fp);
-        switch(c)
-        {
-        case '\n':
-            reading = false;
-            break;
-        case '\r':
-            continue;
-        case EOF:
-            reading = false;
-            not_end_of_file = false;
-            break;
-        case '\0':
-            reading = false;
-            not_end_of_file = false;
-            break;
-        default:
-            buffer[index++] = c;            
-        }
+        last--;
+    }
+    *line_end = last;
+    return next;
+}
+
+static inline bool OBJIsSpace(const char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline void OBJSkipSpace(const char** str, const char* end)
+{
+    while(*str < end && OBJIsSpace(**str))
+    {
+        (*str)++;
+    }
+}
+
+static inline void OBJSkipToken(const char** str, const char* end)
+{
+    while(*str < end && !OBJIsSpace(**str))
+    {
+        (*str)++;
+    }
+}
+
+// Whether the line at str starts with keyword followed by a space or the end of the line
+static inline bool OBJIsKeyword(const char* str, const char* end, const char* keyword, const int length)
+{
+    return end - str >= length && memcmp(str, keyword, length) == 0 && (str + length == end || OBJIsSpace(str[length]));
+}
+
+// An optional sign and digits, stops at the first other character like atoi
+static inline int OBJParseDigits(const char** str, const char* end)
+{
+    const char* ptr = *str;
+    bool negative = false;
+    if(ptr < end && (*ptr == '-' || *ptr == '+'))
+    {
+        negative = *ptr == '-';
+        ptr++;
     }
-    *read_result = index;
-    buffer[index] = '\0';
-    return not_end_of_file;
+    // Unsigned, so too many digits wrap instead of being undefined
+    unsigned r = 0;
+    while(ptr < end && (unsigned)(*ptr - '0') < 10)
+    {
+        r = r * 10 + (*ptr - '0');
+        ptr++;
+    }
+    *str = ptr;
+    return negative ? -(int)r : (int)r;
 }
 
-static inline int OBJParseInt(const char** str)
+static inline int OBJParseInt(const char** str, const char* end)
 {
-    *str += strspn(*str, " \t");
-    int r = atoi(*str);
-    *str += strcspn(*str, " \t\r");
+    OBJSkipSpace(str, end);
+    int r = OBJParseDigits(str, end);
+    OBJSkipToken(str, end);
     return r;
 }
 
-static inline float OBJParseFloat(const char** str)
+static inline float OBJParseFloat(const char** str, const char* end)
 {
-    *str += strspn(*str, " \t");
-    float r = (float)atof(*str);
-    *str += strcspn(*str, " \t\r");
+    OBJSkipSpace(str, end);
+    float r = 0.0f;
+    FastFloat_parse(*str, end, &r);
+    OBJSkipToken(str, end);
     return r;
 }
 
-static inline void OBJParseFloat2(float *x, float *y, const char** str)
+static inline void OBJParseFloat2(float *x, float *y, const char** str, const char* end)
 {
-    *x = OBJParseFloat(str);
-    *y = OBJParseFloat(str);
+    *x = OBJParseFloat(str, end);
+    *y = OBJParseFloat(str, end);
 }
 
-static inline void OBJParseFloat3(float *x, float *y, float *z, const char** str)
+static inline void OBJParseFloat3(float *x, float *y, float *z, const char** str, const char* end)
 {
-    *x = OBJParseFloat(str);
-    *y = OBJParseFloat(str);
-    *z = OBJParseFloat(str);    
+    *x = OBJParseFloat(str, end);
+    *y = OBJParseFloat(str, end);
+    *z = OBJParseFloat(str, end);
 }
 
 static inline int fixIndex(const int index, const int size)
@@ -201,88 +249,79 @@ static inline int fixIndex(const int index, const int size)
     return -1;
 }
 
-static VertexIndex OBJParseFaceTriple(const char** str)
+// v, v/vt, v//vn or v/vt/vn, the indices that are left out are 0
+static VertexIndex OBJParseFaceTriple(const char** str, const char* end)
 {
     VertexIndex vi = {0, 0, 0};
 
-    *str += strspn(*str, " \t");
-    vi.v_idx = atoi(*str);
-    *str += strcspn(*str, "/ \t");
-
-    if((*str)[0] != '/') // Only positions
+    OBJSkipSpace(str, end);
+    vi.v_idx = OBJParseDigits(str, end);
+    if(*str == end || (*str)[0] != '/') // Only positions
     {
+        OBJSkipToken(str, end);
         return vi;
     }
     (*str)++;
 
-    if((*str)[0] == '/')    // No texcoord -- v//vn
+    if(*str < end && (*str)[0] == '/')    // No texcoord -- v//vn
     {
         (*str)++;
-        vi.vn_idx = atoi(*str);
-        *str += strcspn(*str, "/ \t");        
+        vi.vn_idx = OBJParseDigits(str, end);
+        OBJSkipToken(str, end);
         return vi;
     }
-    
-    vi.vt_idx = atoi(*str);
-    *str += strcspn(*str, "/ \t");
-    if((*str)[0] != '/')    // No normal -- v/vt 
+
+    vi.vt_idx = OBJParseDigits(str, end);
+    if(*str == end || (*str)[0] != '/')    // No normal -- v/vt
     {
+        OBJSkipToken(str, end);
         return vi;
     }
     (*str)++;
 
-    vi.vn_idx = atoi(*str);
-    *str += strcspn(*str, "/ \t\r\0");
+    vi.vn_idx = OBJParseDigits(str, end);
+    OBJSkipToken(str, end);
     return vi;
 }
 
-// TODO: length problem
-static void OBJParseString(char buffer[], const char** str)
+// The next token, cut off to fit buffer_size
+static void OBJParseString(char buffer[], const int buffer_size, const char** str, const char* end)
 {
-    *str += strspn(*str, " \t");
-    int length = strcspn(*str, " \t\r\0");
-    stringNCopy(buffer, 128, *str, length);
-    //strncpy_s(buffer, 128, *str, length);
+    OBJSkipSpace(str, end);
+    const char* token = *str;
+    OBJSkipToken(str, end);
+    int length = *str - token < buffer_size - 1 ? (int)(*str - token) : buffer_size - 1;
+    memcpy(buffer, token, length);
     buffer[length] = '\0';
-    *str += length;
-}
-
-static inline void getVertexIndexString(char* string, const VertexIndex* vi)
-{
-#ifdef _MSC_VER
-    sprintf_s(string, 256, "p%dn%dt%d", vi->v_idx, vi->vn_idx, vi->vt_idx);
-#else
-    sprintf(string, "p%dn%dt%d", vi->v_idx, vi->vn_idx, vi->vt_idx);
-#endif
 }
 
-static inline bool vertexIndexComp(const VertexIndex* a, const VertexIndex* b)
+// base_path followed by the rest of the line, cut off to fit OBJ_PATH_LENGTH
+static void OBJParsePath(char path[], const char* base_path, const char* str, const char* end)
 {
-    if(a->v_idx != b->v_idx){return false;}
-    if(a->vn_idx != b->vn_idx){return false;}
-    if(a->vt_idx != b->vt_idx){return false;}
-    return true;
+    stringNCopy(path, OBJ_PATH_LENGTH, base_path, OBJ_PATH_LENGTH - 1);
+    path[OBJ_PATH_LENGTH - 1] = '\0';
+    int base_length = (int)strlen(path);
+    OBJSkipSpace(&str, end);
+    while(end > str && OBJIsSpace(end[-1]))
+    {
+        end--;
+    }
+    int length = end - str < OBJ_PATH_LENGTH - 1 - base_length ? (int)(end - str) : OBJ_PATH_LENGTH - 1 - base_length;
+    memcpy(path + base_length, str, length);
+    path[base_length + length] = '\0';
 }
 
-static int UpdateVertexCache(DBuffer* positions, DBuffer* normals, DBuffer* texcoords, HashIndex* hash_index,
-                      DBuffer* vi_cache,
-                      const VertexIndex* vi, const DBuffer* in_positions, const DBuffer* in_normals,
-                      const DBuffer* in_texcoords)
+// Returns the index of the welded vertex for vi, adding it to the output arrays if it's new
+static inline int UpdateVertexCache(DBuffer* positions, DBuffer* normals, DBuffer* texcoords, VertexHash* vertex_hash,
+                                    const VertexIndex* vi, const DBuffer* in_positions, const DBuffer* in_normals,
+                                    const DBuffer* in_texcoords)
 {
-
-    char vertex_string[256];
-    getVertexIndexString(vertex_string, vi);
-    
-    VertexIndex* vi_cache_ptr = (VertexIndex*)(vi_cache->data);
-    int key = HashIndex_gen_key(hash_index, vertex_string);
-    int i;
-    for(i = HashIndex_First(hash_index, key); i != -1; i = HashIndex_Next(hash_index, i))
+    int new_index = DBuffer_size(*positions) / 3;
+    int index = VertexHash_findOrAdd(vertex_hash, vi->v_idx, vi->vt_idx, vi->vn_idx, new_index);
+    if(index != new_index)
     {
-        if(vertexIndexComp(vi, &(vi_cache_ptr[i])))
-        {
-            return i;
-        }
-    }       
+        return index;
+    }
 
     assert(vi->v_idx * 3 < DBuffer_size(*in_positions));
     float* in_pos_ptr = (float*)(in_positions->data);
@@ -304,17 +343,13 @@ static int UpdateVertexCache(DBuffer* positions, DBuffer* normals, DBuffer* texc
         DBuffer_push(*normals, in_normal_ptr[vi->vn_idx * 3 + 1]);
         DBuffer_push(*normals, in_normal_ptr[vi->vn_idx * 3 + 2]);
     }
-
-    int index = DBuffer_size(*positions) / 3 - 1;
-    HashIndex_add(hash_index, key, index);
-    DBuffer_push(*vi_cache, *vi);
     return index;
 }
 
 static bool exportGroupToShape(OBJShape* shape, const DBuffer* in_positions, const DBuffer* in_normals,
-                        const DBuffer* in_texcoords, DBuffer* in_face_group)
+                        const DBuffer* in_texcoords, DBuffer* in_face_corners, DBuffer* in_faces)
 {
-    if(DBuffer_size(*in_face_group) == 0)
+    if(DBuffer_size(*in_faces) == 0)
     {
         return false;
     }
@@ -322,37 +357,47 @@ static bool exportGroupToShape(OBJShape* shape, const DBuffer* in_positions, con
     DBuffer positions = DBuffer_create(float);
     DBuffer normals = DBuffer_create(float);
     DBuffer texcoords = DBuffer_create(float);
-    DBuffer indices = DBuffer_create(int);
 
-    DBuffer vi_cache = DBuffer_create(VertexIndex);
-    HashIndex hash_index;
-    HashIndex_init(&hash_index, DEFAULT_HASH_SIZE, DEFAULT_INDEX_SIZE);
-    
-    
-    DBuffer* face_group_ptr = (DBuffer*)(in_face_group->data);
-    float prev = 0.0f, current;
-    for(int i = 0; i < DBuffer_size(*in_face_group); i++)
+    const VertexIndex* corners = (const VertexIndex*)(in_face_corners->data);
+    const OBJFace* faces = (const OBJFace*)(in_faces->data);
+    int num_faces = DBuffer_size(*in_faces);
+    int num_triangles = 0;
+    for(int i = 0; i < num_faces; i++)
+    {
+        num_triangles += faces[i].num_corners > 2 ? faces[i].num_corners - 2 : 0;
+    }
+    DBuffer indices = DBuffer_create_cap(int, num_triangles * 3);
+
+    // There can't be more vertices than face corners, nor usually many more than the
+    // largest of the position, texcoord and normal counts
+    int num_corners = DBuffer_size(*in_face_corners);
+    int num_attributes = DBuffer_size(*in_positions) / 3;
+    int num_in_texcoords = DBuffer_size(*in_texcoords) / 2;
+    int num_in_normals = DBuffer_size(*in_normals) / 3;
+    num_attributes = num_in_texcoords > num_attributes ? num_in_texcoords : num_attributes;
+    num_attributes = num_in_normals > num_attributes ? num_in_normals : num_attributes;
+    VertexHash vertex_hash;
+    VertexHash_init(&vertex_hash, num_corners < num_attributes ? num_corners : num_attributes);
+
+    // A fan from the first corner of each face
+    for(int i = 0; i < num_faces; i++)
     {
-        VertexIndex* vi_ptr = (VertexIndex*)(face_group_ptr[i].data);
-        VertexIndex* v0 = &(vi_ptr[0]);
-        VertexIndex* v1;
-        VertexIndex* v2 = &(vi_ptr[1]);
-        for(int j = 2; j < DBuffer_size(face_group_ptr[i]); j++)
-        {
-            v1 = v2;
-            v2++;
-            int i0 = UpdateVertexCache(&positions, &normals, &texcoords, &hash_index, &vi_cache,
+        const VertexIndex* v0 = &(corners[faces[i].first_corner]);
+        for(int j = 2; j < faces[i].num_corners; j++)
+        {
+            const VertexIndex* v1 = v0 + j - 1;
+            const VertexIndex* v2 = v0 + j;
+            int i0 = UpdateVertexCache(&positions, &normals, &texcoords, &vertex_hash,
                                        v0, in_positions, in_normals, in_texcoords);
-            int i1 = UpdateVertexCache(&positions, &normals, &texcoords, &hash_index, &vi_cache,
+            int i1 = UpdateVertexCache(&positions, &normals, &texcoords, &vertex_hash,
                                        v1, in_positions, in_normals, in_texcoords);
-            int i2 = UpdateVertexCache(&positions, &normals, &texcoords, &hash_index, &vi_cache,
-                                       v2, in_positions, in_normals, in_texcoords);            
+            int i2 = UpdateVertexCache(&positions, &normals, &texcoords, &vertex_hash,
+                                       v2, in_positions, in_normals, in_texcoords);
 
             DBuffer_push(indices, i0);
             DBuffer_push(indices, i1);
-            DBuffer_push(indices, i2);                    
+            DBuffer_push(indices, i2);
         }
-        current = (float)i / (DBuffer_size(*in_face_group));
     }
 
     new_shape.positions = (float*)(positions.data);
@@ -364,9 +409,9 @@ static bool exportGroupToShape(OBJShape* shape, const DBuffer* in_positions, con
     new_shape.num_texcoords = DBuffer_size(texcoords);
     new_shape.num_indices = DBuffer_size(indices);
 
-    DBuffer_erase(in_face_group);
-    DBuffer_destroy(&vi_cache);
-    HashIndex_free(&hash_index);
+    DBuffer_clear(*in_face_corners);
+    DBuffer_clear(*in_faces);
+    VertexHash_free(&vertex_hash);
 
     *shape = new_shape;
     return true;
@@ -404,6 +449,7 @@ void OBJMaterial_init(OBJMaterial *obj_material)
     obj_material->ior = 1.0f;
     obj_material->dissolve = 1.0f;
     obj_material->illum = 1;
+    obj_material->name[0] = '\0';
     obj_material->ambient_map[0] = '\0';
     obj_material->diffuse_map[0] = '\0';
     obj_material->specular_map[0] = '\0';
@@ -412,276 +458,141 @@ void OBJMaterial_init(OBJMaterial *obj_material)
     obj_material->alpha_map[0] = '\0';
 }
 
+// The directory part of file_name including its last separator, empty if it has none
+static void OBJGetBasePath(char base_path[], const char* file_name)
+{
+    int char_index;
+    for(char_index = 0; file_name[char_index] != '\0'; char_index++){}
+    for(; char_index > 0 && file_name[char_index] != '\\' && file_name[char_index] != '/'; char_index--){}
+    int length = file_name[char_index] == '\\' || file_name[char_index] == '/' ? char_index + 1 : 0;
+    length = length < OBJ_PATH_LENGTH - 1 ? length : OBJ_PATH_LENGTH - 1;
+    memcpy(base_path, file_name, length);
+    base_path[length] = '\0';
+}
+
 bool loadMTL(DBuffer *obj_materials, const char *file_name)
 {
-    FILE* fp;
-#ifdef _MSC_VER
-    fopen_s(&fp, file_name, "r");
-#else
-    fp = fopen(file_name, "r");
-#endif
-    if(!fp)
+    MappedFile file;
+    if(!file.open(file_name))
     {
         fprintf(stderr, "Cannot open file %s\n", file_name);
         return false;
     }
 
     char base_path[OBJ_PATH_LENGTH];
-    base_path[0] = '\0';
-    unsigned int char_index;
-    for(char_index = 0; file_name[char_index] != '\0'; char_index++){}
-    for(; char_index > 0 && file_name[char_index] != '\\' && file_name[char_index] != '/'; char_index--){}
-    stringNCopy(base_path, OBJ_PATH_LENGTH, file_name, char_index + 1);
-    
+    OBJGetBasePath(base_path, file_name);
+
     OBJMaterial material;
     OBJMaterial_init(&material);
 
-    int read_result;
-    char line_buffer[1024];
-
-    while(OBJGetLine(fp, &read_result, line_buffer, 1024))
+    const char* ptr = file.getData();
+    const char* end = ptr + file.getSize();
+    while(ptr < end)
     {
-        // Skip empty line
-        if(read_result == 0)
-        {
-            continue;
-        }
-
-        const char* line_ptr = &(line_buffer[0]);
+        const char* line_ptr = ptr;
+        const char* line_end;
+        ptr = OBJNextLine(ptr, end, &line_end);
         // Skip leading space
-        line_ptr += strspn(line_ptr, " \t");
+        OBJSkipSpace(&line_ptr, line_end);
 
-        if(line_ptr[0] == '\0' || line_ptr[0] == '#')
+        // Skip empty lines and comments
+        if(line_ptr == line_end || line_ptr[0] == '#')
         {
             continue;
         }
 
-        if(strncmp(line_ptr, "newmtl", 6) == 0 && line_ptr[6] == ' ')
+        if(OBJIsKeyword(line_ptr, line_end, "newmtl", 6))
         {
             if(!(material.name[0] == '\0'))
             {
                 DBuffer_push(*obj_materials, material);
             }
             OBJMaterial_init(&material);
-            char name_buffer[OBJ_PATH_LENGTH];
-            line_ptr += 7;
-#ifdef _MSC_VER
-            sscanf_s(line_ptr, "%s", name_buffer, OBJ_PATH_LENGTH);
-#else
-            sscanf(line_ptr, "%s", name_buffer);
-#endif
-            stringCopy(material.name, OBJ_NAME_LENGTH, name_buffer);
-            continue;
-        }
-
-        // Ambient
-        if(line_ptr[0] == 'K' && line_ptr[1] == 'a' && line_ptr[2] == ' ')
+            line_ptr += 6;
+            OBJParseString(material.name, OBJ_NAME_LENGTH, &line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Ka", 2))    // Ambient
         {
-            line_ptr += 3;
-            float r, g, b;
-            OBJParseFloat3(&r, &g, &b, &line_ptr);
-            material.ambient[0] = r;
-            material.ambient[1] = g;
-            material.ambient[2] = b;
-            continue;
-        }
-
-        // Diffuse
-        if(line_ptr[0] == 'K' && line_ptr[1] == 'd' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            OBJParseFloat3(&material.ambient[0], &material.ambient[1], &material.ambient[2], &line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Kd", 2))    // Diffuse
         {
-            line_ptr += 3;
-            float r, g, b;
-            OBJParseFloat3(&r, &g, &b, &line_ptr);
-            material.diffuse[0] = r;
-            material.diffuse[1] = g;
-            material.diffuse[2] = b;
-            continue;
-        }
-
-        // Specular
-        if(line_ptr[0] == 'K' && line_ptr[1] == 's' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            OBJParseFloat3(&material.diffuse[0], &material.diffuse[1], &material.diffuse[2], &line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Ks", 2))    // Specular
         {
-            line_ptr += 3;
-            float r, g, b;
-            OBJParseFloat3(&r, &g, &b, &line_ptr);
-            material.specular[0] = r;
-            material.specular[1] = g;
-            material.specular[2] = b;
-            continue;
-        }
-
-        // Emissive
-        if(line_ptr[0] == 'K' && line_ptr[1] == 'e' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            OBJParseFloat3(&material.specular[0], &material.specular[1], &material.specular[2], &line_ptr,
+                           line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Ke", 2))    // Emissive
         {
-            line_ptr += 3;
-            float r, g, b;
-            OBJParseFloat3(&r, &g, &b, &line_ptr);
-            material.emissive[0] = r;
-            material.emissive[1] = g;
-            material.emissive[2] = b;
-            continue;
-        }
-
-        // Transmittance
-        if(line_ptr[0] == 'K' && line_ptr[1] == 'e' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            OBJParseFloat3(&material.emissive[0], &material.emissive[1], &material.emissive[2], &line_ptr,
+                           line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Tf", 2))    // Transmittance
         {
-            line_ptr += 3;
-            float r, g, b;
-            OBJParseFloat3(&r, &g, &b, &line_ptr);
-            material.transmittance[0] = r;
-            material.transmittance[1] = g;
-            material.transmittance[2] = b;
-            continue;
-        }
-
-        // Index of refraction
-        if(line_ptr[0] == 'N' && line_ptr[1] == 'i' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            OBJParseFloat3(&material.transmittance[0], &material.transmittance[1], &material.transmittance[2],
+                           &line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Ni", 2))    // Index of refraction
         {
-            line_ptr += 3;
-            material.ior = OBJParseInt(&line_ptr);
-            continue;
-        }
-
-        // Shininess
-        if(line_ptr[0] == 'N' && line_ptr[1] == 's' && line_ptr[2] == ' ')
+            line_ptr += 2;
+            material.ior = OBJParseFloat(&line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Ns", 2))    // Shininess
         {
-            line_ptr += 3;
-            material.shininess = OBJParseInt(&line_ptr);
-            continue;
-        }
-
-        // illum model
-        if(strncmp(line_ptr, "illum", 5) == 0 && line_ptr[5] == ' ')
+            line_ptr += 2;
+            material.shininess = OBJParseFloat(&line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "illum", 5))    // illum model
         {
-            line_ptr += 6;
-            material.illum = OBJParseInt(&line_ptr);
-            continue;
-        }
-
-        // Dissolve
-        if(line_ptr[0] == 'd' && line_ptr[1] == ' ')
+            line_ptr += 5;
+            material.illum = OBJParseInt(&line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "d", 1))    // Dissolve
+        {
+            line_ptr += 1;
+            material.dissolve = OBJParseFloat(&line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "Tr", 2))
         {
             line_ptr += 2;
-            material.dissolve = OBJParseInt(&line_ptr);
-            continue;
-        }
-        if(line_ptr[0] == 'T' && line_ptr[1] == 'r' && line_ptr[2] == ' ')
+            material.dissolve = 1.0f - OBJParseFloat(&line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_Ka", 6))    // Ambient map
         {
-            line_ptr += 3;
-            material.dissolve = 1.0f - OBJParseInt(&line_ptr);
-            continue;
-        }
-
-        // Ambient map
-        if(strncmp(line_ptr, "map_Ka", 6) == 0 && line_ptr[6] == ' ')
+            OBJParsePath(material.ambient_map, base_path, line_ptr + 6, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_Kd", 6))    // Diffuse map
         {
-            line_ptr += 7;
-            //stringCopy(material.ambient_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.ambient_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.ambient_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.ambient_map, line_ptr);
-#endif
-            continue;
-        }
-
-        // Diffuse map
-        if(strncmp(line_ptr, "map_Kd", 6) == 0 && line_ptr[6] == ' ')
+            OBJParsePath(material.diffuse_map, base_path, line_ptr + 6, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_Ks", 6))    // Specular map
         {
-            line_ptr += 7;
-            stringCopy(material.diffuse_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.diffuse_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.diffuse_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.diffuse_map, line_ptr);
-#endif
-            continue;
-        }
-
-        // Specular map
-        if(strncmp(line_ptr, "map_Ks", 6) == 0 && line_ptr[6] == ' ')
+            OBJParsePath(material.specular_map, base_path, line_ptr + 6, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_Ns", 6))    // Shininess map
         {
-            line_ptr += 7;
-            stringCopy(material.specular_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.specular_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.specular_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.specular_map, line_ptr);
-#endif
-            continue;
-        }
-
-        // Shininess map
-        if(strncmp(line_ptr, "map_Ns", 6) == 0 && line_ptr[6] == ' ')
+            OBJParsePath(material.shininess_map, base_path, line_ptr + 6, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_bump", 8))    // Normal map
         {
-            line_ptr += 7;
-            stringCopy(material.shininess_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.shininess_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.shininess_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.shininess_map, line_ptr);
-#endif
-            continue;
-        }
-
-        // Normal map
-        if(strncmp(line_ptr, "map_bump", 8) == 0 && line_ptr[8] == ' ')
+            OBJParsePath(material.normal_map, base_path, line_ptr + 8, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "map_d", 5))    // Alpha map
         {
-            line_ptr += 9;
-            stringCopy(material.normal_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.normal_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.normal_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.normal_map, line_ptr);
-#endif
-            continue;
-        }
-
-        // Alpha map
-        if(strncmp(line_ptr, "map_d", 5) == 0 && line_ptr[5] == ' ')
-        {
-            line_ptr += 6;
-            stringCopy(material.alpha_map, OBJ_PATH_LENGTH, line_ptr);
-            stringCopy(material.alpha_map, OBJ_PATH_LENGTH, base_path);
-#ifdef _MSC_VER
-            strcat_s(material.alpha_map, OBJ_NAME_LENGTH, line_ptr);
-#else
-            strcat(material.alpha_map, line_ptr);
-#endif
-            continue;
+            OBJParsePath(material.alpha_map, base_path, line_ptr + 5, line_end);
         }
     }
     if(material.name[0] != '\0')
     {
         DBuffer_push(*obj_materials, material);
     }
+    return true;
 }
 
 bool loadOBJ(OBJShape** shapes, OBJMaterial ** materials, int *num_shape, int *num_mat, const char* file_name)
 {
-    FILE* fp;
-#ifdef _MSC_VER
-    fopen_s(&fp, file_name, "r");
-#else
-    fp = fopen(file_name, "r");
-#endif
-    if(!fp)
+    MappedFile file;
+    if(!file.open(file_name))
     {
         fprintf(stderr, "Cannot open file %s\n", file_name);
         return false;
     }
-    int read_result;
-    char line_buffer[1024];
-    char cur_mat_name[128];
+    char cur_mat_name[OBJ_NAME_LENGTH];
     cur_mat_name[0] = '\0';
-    char mesh_name[128];
+    char mesh_name[OBJ_NAME_LENGTH];
     int i;
-    for(i = 0; file_name[i] != '.'; i++){}
+    for(i = 0; file_name[i] != '.' && file_name[i] != '\0' && i < OBJ_NAME_LENGTH - 1; i++){}
     stringNCopy(mesh_name, OBJ_NAME_LENGTH, file_name, i);
     mesh_name[i] = '\0';
 
@@ -692,156 +603,110 @@ bool loadOBJ(OBJShape** shapes, OBJMaterial ** materials, int *num_shape, int *n
     DBuffer in_normals = DBuffer_create(float);
     DBuffer in_texcoords = DBuffer_create(float);
 
-    /*
-                            .       .       .       .       .       .       .      
-                            .       .       .       .       .       .       .      
-                            .       .       .       .       .       .       .      
-                            .       .       .       .       .       .       .
-                            VI      VI      VI      VI      VI      VI      VI
-                            VI      VI      VI      VI      VI      VI      VI
-                            VI      VI      VI      VI      VI      VI      VI                            
-      in_face_group.data -> DBuffer DBuffer DBuffer DBuffer DBuffer DBuffer DBuffer......
-                    size
-                    max
-                    element_size
-     */
-    DBuffer in_face_group = DBuffer_create(DBuffer);
-
-    while(OBJGetLine(fp, &read_result, line_buffer, 1024))
+    // The faces of the group being read, with all their corners one after another
+    DBuffer in_face_corners = DBuffer_create(VertexIndex);
+    DBuffer in_faces = DBuffer_create(OBJFace);
+
+    const char* ptr = file.getData();
+    const char* end = ptr + file.getSize();
+    while(ptr < end)
     {
+        const char* line_ptr = ptr;
+        const char* line_end;
+        ptr = OBJNextLine(ptr, end, &line_end);
         // Remove leading space
-        const char* line_ptr = &(line_buffer[0]);
-        line_ptr += strspn(line_ptr, " \t");
+        OBJSkipSpace(&line_ptr, line_end);
 
-        if(line_ptr[0] == '#')
+        if(line_ptr == line_end || line_ptr[0] == '#')
         {
             continue;
         }
 
-        // Position
-        if(line_ptr[0] == 'v' && line_ptr[1] == ' ')
+        if(OBJIsKeyword(line_ptr, line_end, "v", 1))    // Position
         {
             line_ptr += 1; // Skip "v"
             float x, y, z;
-            OBJParseFloat3(&x, &y, &z, &line_ptr);
+            OBJParseFloat3(&x, &y, &z, &line_ptr, line_end);
             DBuffer_push(in_positions, x);
             DBuffer_push(in_positions, y);
             DBuffer_push(in_positions, z);
-        }
-
-        // Normal
-        if(line_ptr[0] == 'v' && line_ptr[1] == 'n')
+        }else if(OBJIsKeyword(line_ptr, line_end, "vn", 2))    // Normal
         {
             line_ptr += 2; // Skip "vn"
             float x, y, z;
-            OBJParseFloat3(&x, &y, &z, &line_ptr);
+            OBJParseFloat3(&x, &y, &z, &line_ptr, line_end);
             DBuffer_push(in_normals, x);
             DBuffer_push(in_normals, y);
             DBuffer_push(in_normals, z);
-        }
-
-        // Texcoord
-        if(line_ptr[0] == 'v' && line_ptr[1] == 't')
+        }else if(OBJIsKeyword(line_ptr, line_end, "vt", 2))    // Texcoord
         {
             line_ptr += 2; // Skip "vt"
             float u, v;
-            OBJParseFloat2(&u, &v, &line_ptr);
+            OBJParseFloat2(&u, &v, &line_ptr, line_end);
             DBuffer_push(in_texcoords, u);
             DBuffer_push(in_texcoords, v);
-        }
-
-        // Face
-        if(line_ptr[0] == 'f' && line_ptr[1] == ' ')
+        }else if(OBJIsKeyword(line_ptr, line_end, "f", 1))    // Face
         {
             line_ptr += 1; // Skip "f"
-            DBuffer face = DBuffer_create_cap(VertexIndex, 4);
-            int count = 0;
-            while(line_ptr[0] != '\0' && line_ptr < line_buffer + strlen(line_buffer))
+            OBJFace face;
+            face.first_corner = DBuffer_size(in_face_corners);
+            OBJSkipSpace(&line_ptr, line_end);
+            while(line_ptr < line_end)
             {
-                count++;
-                VertexIndex vi = OBJParseFaceTriple(&line_ptr);
+                VertexIndex vi = OBJParseFaceTriple(&line_ptr, line_end);
+                OBJSkipSpace(&line_ptr, line_end);
                 vi.v_idx = fixIndex(vi.v_idx, DBuffer_size(in_positions) / 3);
                 vi.vt_idx = fixIndex(vi.vt_idx, DBuffer_size(in_texcoords) / 2);
                 vi.vn_idx = fixIndex(vi.vn_idx, DBuffer_size(in_normals) / 3);
-                /*
-                if(vi.v_idx < 0)
-                {
-                    printf("here\n");
-                }
-                */
                 // TODO: fix this
                 if(vi.v_idx != -1)
                 {
-                    DBuffer_push(face, vi);
+                    DBuffer_push(in_face_corners, vi);
                 }
             }
-            DBuffer_push(in_face_group, face);
-        }
-
-        if(line_ptr[0] == 'g')
+            face.num_corners = DBuffer_size(in_face_corners) - face.first_corner;
+            DBuffer_push(in_faces, face);
+        }else if(line_ptr[0] == 'g')
         {
             OBJShape shape;
-            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_group))
+            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_corners, &in_faces))
             {
                 stringCopy(shape.mesh_name, OBJ_NAME_LENGTH, mesh_name);
                 stringCopy(shape.mat_name, OBJ_NAME_LENGTH, cur_mat_name);
                 DBuffer_push(obj_shapes, shape);
             }
-        }
-
-        if(line_ptr[0] == 'u' && strncmp(line_ptr, "usemtl", 6) == 0)
+        }else if(OBJIsKeyword(line_ptr, line_end, "usemtl", 6))
         {
             OBJShape shape;
-            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_group))
+            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_corners, &in_faces))
             {
                 stringCopy(shape.mesh_name, OBJ_NAME_LENGTH, mesh_name);
                 stringCopy(shape.mat_name, OBJ_NAME_LENGTH, cur_mat_name);
                 DBuffer_push(obj_shapes, shape);
             }
             line_ptr += 6;    // Skip over "usemtl"
-            OBJParseString(cur_mat_name, &line_ptr);
-        }
-
-        if(line_ptr[0] == 'o' && line_ptr[1] == ' ')
+            OBJParseString(cur_mat_name, OBJ_NAME_LENGTH, &line_ptr, line_end);
+        }else if(OBJIsKeyword(line_ptr, line_end, "o", 1))
         {
             OBJShape shape;
-            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_group))
+            if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_corners, &in_faces))
             {
                 DBuffer_push(obj_shapes, shape);
             }
-        }
-
-        if((strncmp(line_ptr, "mtllib", 6) == 0) && line_ptr[6] == ' ')
+        }else if(OBJIsKeyword(line_ptr, line_end, "mtllib", 6))
         {
-            line_ptr += 7;
+            line_ptr += 6;
             char name_buffer[OBJ_PATH_LENGTH];
-#ifdef _MSC_VER
-            sscanf_s(line_ptr, "%s", name_buffer, OBJ_PATH_LENGTH);
-#else
-            sscanf(line_ptr, "%s", name_buffer);
-#endif
-            unsigned int char_index;
-            for(char_index = 0; file_name[char_index] != '\0'; char_index++){}
-            for(; char_index > 0 && file_name[char_index] != '\\' && file_name[char_index] != '/';
-                char_index--){}            
+            OBJParseString(name_buffer, OBJ_PATH_LENGTH, &line_ptr, line_end);
+            char base_path[OBJ_PATH_LENGTH];
+            OBJGetBasePath(base_path, file_name);
             char mtl_path[OBJ_PATH_LENGTH];
-            if(char_index > 0)
-            {
-                stringNCopy(mtl_path, OBJ_PATH_LENGTH, file_name, char_index + 1);
-            }else
-            {
-                mtl_path[0] = '\0';
-            }
-#ifdef _MSC_VER
-            strcat_s(mtl_path, OBJ_NAME_LENGTH, name_buffer);
-#else
-            strcat(mtl_path, name_buffer);
-#endif
+            OBJParsePath(mtl_path, base_path, name_buffer, name_buffer + strlen(name_buffer));
             loadMTL(&obj_materials, mtl_path);
         }
     }
     OBJShape shape;
-    if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_group))
+    if(exportGroupToShape(&shape, &in_positions, &in_normals, &in_texcoords, &in_face_corners, &in_faces))
     {
         stringCopy(shape.mesh_name, OBJ_NAME_LENGTH, mesh_name);
         stringCopy(shape.mat_name, OBJ_NAME_LENGTH, cur_mat_name);        
@@ -898,16 +763,12 @@ bool loadOBJ(OBJShape** shapes, OBJMaterial ** materials, int *num_shape, int *n
         printf("\n");
     }
 #endif
-    DBuffer* face_ptr = (DBuffer*)(in_face_group.data);
     DBuffer_destroy(&in_positions);
     DBuffer_destroy(&in_normals);
     DBuffer_destroy(&in_texcoords);
 
-    for(int i = 0; i < DBuffer_size(in_face_group); i++)
-    {
-        DBuffer_destroy(&(face_ptr[i]));
-    }
-    DBuffer_destroy(&in_face_group);
+    DBuffer_destroy(&in_face_corners);
+    DBuffer_destroy(&in_faces);
     
     *shapes = (OBJShape*)(obj_shapes.data);
     *num_shape = DBuffer_size(obj_shapes);
@@ -918,10 +779,15 @@ bool loadOBJ(OBJShape** shapes, OBJMaterial ** materials, int *num_shape, int *n
 
 void OBJShape_destroy(OBJShape* obj_shape)
 {
-    if(obj_shape->num_positions > 0){free(obj_shape->positions);}
-    if(obj_shape->num_normals > 0){free(obj_shape->normals);}
-    if(obj_shape->num_texcoords > 0){free(obj_shape->texcoords);}
-    if(obj_shape->num_indices > 0){free(obj_shape->indices);}
+    // The arrays are allocated even when they are empty
+    free(obj_shape->positions);
+    free(obj_shape->normals);
+    free(obj_shape->texcoords);
+    free(obj_shape->indices);
+    obj_shape->positions = NULL;
+    obj_shape->normals = NULL;
+    obj_shape->texcoords = NULL;
+    obj_shape->indices = NULL;
 
     obj_shape->num_positions = 0;
     obj_shape->num_normals = 0;
@@ -0,0 +1,126 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/*
+  Map from a (v, vt, vn) index triple to the index of the welded vertex
+  Open addressing with linear probing in a power of two table that is kept at most
+  half full, so a lookup is a hash of the three integers and usually one or two
+  slot compares. Size it for the expected number of vertices up front, it doubles
+  when it runs out.
+ */
+const int VERTEX_HASH_MIN_CAPACITY = 64;
+const int VERTEX_HASH_EMPTY = -1;
+
+typedef struct VertexHashSlot_s
+{
+    int v_idx, vt_idx, vn_idx;
+    int index;          // VERTEX_HASH_EMPTY if the slot is free
+}VertexHashSlot;
+
+typedef struct VertexHash_s
+{
+    VertexHashSlot* slots;
+    int capacity;       // Power of two
+    int size;
+}VertexHash;
+
+void VertexHash_init(VertexHash* vertex_hash, const int expected_size);
+void VertexHash_free(VertexHash* vertex_hash);
+void VertexHash_grow(VertexHash* vertex_hash);
+
+inline uint32_t VertexHash_hash(const int v_idx, const int vt_idx, const int vn_idx)
+{
+    uint64_t h = (uint32_t)v_idx * 0x9E3779B97F4A7C15ull;
+    h ^= (uint32_t)vt_idx * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint32_t)vn_idx * 0x165667B19E3779F9ull;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+// The slot holding the triple, or the empty slot where it goes
+inline VertexHashSlot* VertexHash_find(const VertexHash* vertex_hash, const int v_idx, const int vt_idx,
+                                       const int vn_idx)
+{
+    uint32_t mask = vertex_hash->capacity - 1;
+    uint32_t i = VertexHash_hash(v_idx, vt_idx, vn_idx) & mask;
+    while(true)
+    {
+        VertexHashSlot* slot = &(vertex_hash->slots[i]);
+        if(slot->index == VERTEX_HASH_EMPTY ||
+           (slot->v_idx == v_idx && slot->vt_idx == vt_idx && slot->vn_idx == vn_idx))
+        {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// Returns the index stored for the triple, or stores new_index for it and returns that
+inline int VertexHash_findOrAdd(VertexHash* vertex_hash, const int v_idx, const int vt_idx, const int vn_idx,
+                                const int new_index)
+{
+    VertexHashSlot* slot = VertexHash_find(vertex_hash, v_idx, vt_idx, vn_idx);
+    if(slot->index != VERTEX_HASH_EMPTY)
+    {
+        return slot->index;
+    }
+    if((vertex_hash->size + 1) * 2 > vertex_hash->capacity)
+    {
+        VertexHash_grow(vertex_hash);
+        slot = VertexHash_find(vertex_hash, v_idx, vt_idx, vn_idx);
+    }
+    slot->v_idx = v_idx;
+    slot->vt_idx = vt_idx;
+    slot->vn_idx = vn_idx;
+    slot->index = new_index;
+    vertex_hash->size++;
+    return new_index;
+}
+
+#ifdef OBJ_LOADER_IMPLEMENTATION
+static void VertexHash_alloc(VertexHash* vertex_hash, const int capacity)
+{
+    vertex_hash->slots = (VertexHashSlot*)malloc(sizeof(VertexHashSlot) * capacity);
+    // All bits set makes every index VERTEX_HASH_EMPTY
+    memset(vertex_hash->slots, 0xff, sizeof(VertexHashSlot) * capacity);
+    vertex_hash->capacity = capacity;
+}
+
+void VertexHash_init(VertexHash* vertex_hash, const int expected_size)
+{
+    int capacity = VERTEX_HASH_MIN_CAPACITY;
+    while(capacity < expected_size * 2)
+    {
+        capacity *= 2;
+    }
+    VertexHash_alloc(vertex_hash, capacity);
+    vertex_hash->size = 0;
+}
+
+void VertexHash_free(VertexHash* vertex_hash)
+{
+    free(vertex_hash->slots);
+    vertex_hash->slots = NULL;
+    vertex_hash->capacity = 0;
+    vertex_hash->size = 0;
+}
+
+void VertexHash_grow(VertexHash* vertex_hash)
+{
+    VertexHashSlot* old_slots = vertex_hash->slots;
+    int old_capacity = vertex_hash->capacity;
+    assert(old_capacity > 0);
+    VertexHash_alloc(vertex_hash, old_capacity * 2);
+    for(int i = 0; i < old_capacity; i++)
+    {
+        const VertexHashSlot* old_slot = &(old_slots[i]);
+        if(old_slot->index != VERTEX_HASH_EMPTY)
+        {
+            *VertexHash_find(vertex_hash, old_slot->v_idx, old_slot->vt_idx, old_slot->vn_idx) = *old_slot;
+        }
+    }
+    free(old_slots);
+}
+#endif
@@ -0,0 +1,182 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <GL/glew.h>
+#include "vec.h"
+#include "glstate.h"
+
+enum RenderPass
+{
+    // Depth tested and written, no blending, sorted by state then front to back
+    PASS_OPAQUE,
+    // Depth tested but not written, alpha blended, sorted back to front
+    PASS_TRANSPARENT,
+    // No depth test or blending, drawn in the order submitted, for editor handles
+    PASS_OVERLAY,
+    NUM_RENDER_PASSES
+};
+
+struct DrawItem;
+typedef void (*DrawFunction)(const DrawItem& item);
+
+/*
+  One draw submitted to a RenderQueue
+  The queue binds program, vertex_array and texture (on unit 0, when not 0) before
+  calling draw, which sets what is left, like uniforms or instance pointers, and
+  issues the draw calls. object, data and count are for draw to use.
+ */
+struct DrawItem
+{
+    uint64_t key;
+    GLuint program;
+    GLuint vertex_array;
+    GLuint texture;
+    DrawFunction draw;
+    const void* object;
+    GLintptr data;
+    int count;
+};
+
+/*
+  Collects the draws of one view and executes them sorted on a 64-bit key
+  Opaque and overlay keys put the pass first, then the program, vertex array and
+  texture, so draws that share state end up next to each other and g_gl_state
+  elides the binds between them. Opaque draws are ordered front to back within
+  the same state. Transparent keys put the depth inverted right after the pass so
+  they are blended back to front. Overlay keys keep the order of submission.
+  The pass state (depth test, depth writes, blending) is set once per pass.
+  Bit layout, high to low:
+    opaque      pass 2 | program 10 | vertex array 12 | texture 12 | depth 28
+    transparent pass 2 | ~depth 28 | program 10 | vertex array 12 | texture 12
+    overlay     pass 2 | unused 30 | submission order 32
+  GL names wider than their field only make the sort less exact, the item holds
+  the full names.
+ */
+class RenderQueue
+{
+public:
+    RenderQueue()
+        :num_submitted(0)
+    {
+    }
+
+    // Starts a view, depth of items is their distance from camera_pos
+    void begin(const Vec3& camera_pos)
+    {
+        this->camera_pos = camera_pos;
+        items.clear();
+        num_submitted = 0;
+    }
+
+    float calcDepth(const Vec3& pos) const
+    {
+        return (pos - camera_pos).length();
+    }
+
+    void submit(const RenderPass pass, const GLuint program, const GLuint vertex_array, const GLuint texture,
+                const float depth, const DrawFunction draw, const void* object, const GLintptr data = 0,
+                const int count = 0)
+    {
+        DrawItem item;
+        item.key = makeKey(pass, program, vertex_array, texture, depth, num_submitted);
+        item.program = program;
+        item.vertex_array = vertex_array;
+        item.texture = texture;
+        item.draw = draw;
+        item.object = object;
+        item.data = data;
+        item.count = count;
+        items.push_back(item);
+        num_submitted++;
+    }
+
+    // Draws everything submitted since begin, leaves the opaque pass state set
+    void execute()
+    {
+        std::sort(items.begin(), items.end(), compareKeys);
+        int pass = -1;
+        for(int i = 0; i < items.size(); i++)
+        {
+            const DrawItem& item = items[i];
+            int item_pass = (int)(item.key >> PASS_SHIFT);
+            if(item_pass != pass)
+            {
+                pass = item_pass;
+                setPassState(pass);
+            }
+            g_gl_state.useProgram(item.program);
+            g_gl_state.bindVertexArray(item.vertex_array);
+            if(item.texture)
+            {
+                g_gl_state.bindTexture2D(0, item.texture);
+            }
+            item.draw(item);
+        }
+        if(pass != PASS_OPAQUE)
+        {
+            setPassState(PASS_OPAQUE);
+        }
+        items.clear();
+    }
+
+    int getNumItems() const
+    {
+        return items.size();
+    }
+
+private:
+    static const int PASS_SHIFT = 62;
+
+    static bool compareKeys(const DrawItem& a, const DrawItem& b)
+    {
+        return a.key < b.key;
+    }
+
+    static uint64_t makeKey(const RenderPass pass, const GLuint program, const GLuint vertex_array,
+                            const GLuint texture, const float depth, const int order)
+    {
+        uint64_t state = ((uint64_t)(program & 0x3ff) << 24) | ((uint64_t)(vertex_array & 0xfff) << 12) |
+                         (uint64_t)(texture & 0xfff);
+        uint64_t key = (uint64_t)pass << PASS_SHIFT;
+        if(pass == PASS_OPAQUE)
+        {
+            key |= (state << 28) | quantizeDepth(depth);
+        }else if(pass == PASS_TRANSPARENT)
+        {
+            key |= ((uint64_t)(quantizeDepth(depth) ^ 0xfffffff) << 34) | state;
+        }else
+        {
+            key |= (uint32_t)order;
+        }
+        return key;
+    }
+
+    // The bits of a non-negative float sort like its value, the top 28 of its 31 are kept
+    static uint32_t quantizeDepth(const float depth)
+    {
+        if(!(depth > 0.0f))
+        {
+            return 0;
+        }
+        uint32_t bits;
+        memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 3;
+    }
+
+    static void setPassState(const int pass)
+    {
+        g_gl_state.setDepthTest(pass != PASS_OVERLAY);
+        g_gl_state.setDepthMask(pass == PASS_OPAQUE);
+        g_gl_state.setBlend(pass == PASS_TRANSPARENT);
+        if(pass == PASS_TRANSPARENT)
+        {
+            g_gl_state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+    }
+
+    std::vector<DrawItem> items;
+    Vec3 camera_pos;
+    int num_submitted;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdio>
+#include "glstate.h"
+
+/*
+  An offscreen framebuffer with a color texture and a depth renderbuffer
+  Render into it between bind and unbind, then copy it to a viewport of the
+  default framebuffer with blitTo. Textures are only reallocated when the size
+  changes.
+ */
+class RenderTarget
+{
+public:
+    RenderTarget()
+        :fbo(0), color_texture(0), depth_rbo(0), width(0), height(0)
+    {
+    }
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    ~RenderTarget()
+    {
+        destroy();
+    }
+
+    // Returns true if the target was (re)created, its contents are undefined then
+    bool resize(const int new_width, const int new_height)
+    {
+        if(fbo && new_width == width && new_height == height)
+        {
+            return false;
+        }
+        destroy();
+        width = new_width;
+        height = new_height;
+        glGenFramebuffers(1, &fbo);
+        glGenTextures(1, &color_texture);
+        glGenRenderbuffers(1, &depth_rbo);
+
+        g_gl_state.bindTexture2D(0, color_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_rbo);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rbo);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            fprintf(stderr, "Render target %dx%d is incomplete\n", width, height);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+    // Sets the viewport to the whole target
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+    }
+
+    static void unbind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // Copies the color buffer to the default framebuffer at x, y
+    void blitTo(const int x, const int y) const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+
+    void destroy()
+    {
+        if(!fbo)
+        {
+            return;
+        }
+        glDeleteFramebuffers(1, &fbo);
+        g_gl_state.deleteTexture(color_texture);
+        glDeleteRenderbuffers(1, &depth_rbo);
+        fbo = color_texture = depth_rbo = 0;
+    }
+
+private:
+    GLuint fbo, color_texture, depth_rbo;
+    int width, height;
+};
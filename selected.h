@@ -1,47 +1,43 @@
 #pragma once
 #include "box.h"
+#include "track.h"
+#include <algorithm>
+#include <functional>
 
 class Selected
 {
 public:
     Selected(Track& t)
-        :track(t), selected_color(0.5f, 0.5f, 0.5f)
+        :track(t), selected_color(0.5f, 0.5f, 0.5f), revision(0)
     {}
 
     bool rayIntersect(float &t, int& hit_side, const Ray& ray)
     {
-        float min_t = FLT_MAX;
-        int min_hit_side;
-        bool hit = false;
-        for(int i = 0; i < box_indices.size(); i++)
-        {
-            int face = -1;
-            float tmp_t = track.getBoxAtIndex(box_indices[i]).rayIntersect(face, ray);
-            if(tmp_t < min_t)
-            {
-                min_t = tmp_t;
-                min_hit_side = face;
-                hit = true;
-            }
-        }
-        t = min_t;
-        hit_side = min_hit_side;
-        return hit;
+        // box_indices is kept in non-increasing order
+        const std::vector<int>& indices = box_indices;
+        int index = track.rayIntersectTrack(hit_side, t, ray, [&indices](const int i)
+                                            {
+                                                return std::binary_search(indices.begin(), indices.end(), i,
+                                                                          std::greater<int>());
+                                            });
+        return index != -1;
     }
 
     // Remove selected boxes from track
     void remove()
     {
-        // TODO: when I copied multiple boxes then tried to remove them together,
-        // not all of them were removed.
+        // Track moves its last box into a removed slot. Removing in non-increasing order
+        // means the moved box is never one that is still waiting to be removed.
         for(int i = 0; i < box_indices.size(); i++)
         {
-            track.getBoxAtIndex(box_indices[i]).setColor(box_colors[i]);
+            track.setBoxColor(box_indices[i], box_colors[i]);
             track.removeBox(box_indices[i]);            
         }
         // No old indices are kept after track removes any box
         box_indices.clear();
         box_colors.clear();
+        continuous_bounds.clear();
+        revision++;
     }
 
     // Copy selected boxes
@@ -50,10 +46,16 @@ public:
         for(int i = 0; i < box_indices.size(); i++)
         {
             Box new_box = track.getBoxAtIndex(box_indices[i]).makeCopy();
-            track.getBoxAtIndex(box_indices[i]).setColor(box_colors[i]);
+            track.setBoxColor(box_indices[i], box_colors[i]);
             int new_box_index = track.addBox(new_box);
             box_indices[i] = new_box_index;
+            continuous_bounds[i] = BBox(new_box.min, new_box.max);
         }
+        // The copies were appended in increasing order, flip them back to non-increasing
+        std::reverse(box_indices.begin(), box_indices.end());
+        std::reverse(box_colors.begin(), box_colors.end());
+        std::reverse(continuous_bounds.begin(), continuous_bounds.end());
+        revision++;
     }
 
     Vec3 getSideNormal(const int hit_side)
@@ -69,26 +71,33 @@ public:
     {
         for(int i = 0; i < box_indices.size(); i++)
         {
-            track.getBoxAtIndex(box_indices[i]).changeLength(side_num, amount);
+            continuous_bounds[i].changeLength(side_num, amount);
+            track.getBoxAtIndex(box_indices[i]).setContinuousBounds(continuous_bounds[i]);
+            track.refitBox(box_indices[i]);
         }
         bound_all.changeLength(side_num, amount);
+        revision++;
     }
 
     void move(const Vec3& v)
     {
         for(int i = 0; i < box_indices.size(); i++)
         {
-            track.getBoxAtIndex(box_indices[i]).move(v);
+            continuous_bounds[i].move(v);
+            track.getBoxAtIndex(box_indices[i]).setContinuousBounds(continuous_bounds[i]);
+            track.refitBox(box_indices[i]);
         }
         bound_all.min += v;
         bound_all.max += v;
+        revision++;
     }
 
     void syncSelectedMinMax()
     {
         for(int i = 0; i < box_indices.size(); i++)
         {
-            track.getBoxAtIndex(box_indices[i]).syncMinMax();
+            const Box& box = track.getBoxAtIndex(box_indices[i]);
+            continuous_bounds[i] = BBox(box.min, box.max);
         }        
     }
 
@@ -101,7 +110,7 @@ public:
                 return false;
             }
         }
-        Box& box = track.getBoxAtIndex(index);
+        const Box& box = track.getBoxAtIndex(index);
         if(box_indices.size() == 0)
         {            
             bound_all.min = box.min;
@@ -114,6 +123,7 @@ public:
         // this call to push_back is for making room for the new index
         box_colors.push_back(Vec3());
         box_indices.push_back(-1); 
+        continuous_bounds.push_back(BBox());
         // Keep box_indices in non-increasing order
         int i;
         for(i = 0; i < box_indices.size() - 1 && box_indices[i] > index; i++){}
@@ -121,10 +131,13 @@ public:
         {
             box_indices[j] = box_indices[j-1];
             box_colors[j] = box_colors[j-1];
+            continuous_bounds[j] = continuous_bounds[j-1];
         }
         box_indices[i] = index;
         box_colors[i] = box.getColor();
-        box.setColor(selected_color);
+        continuous_bounds[i] = BBox(box.min, box.max);
+        track.setBoxColor(index, selected_color);
+        revision++;
         return true;
     }
 
@@ -146,9 +159,10 @@ public:
         {
             if(box_indices[i] == index)
             {
-                track.getBoxAtIndex(box_indices[i]).setColor(box_colors[i]);
+                track.setBoxColor(box_indices[i], box_colors[i]);
                 box_indices.erase(box_indices.begin() + i);
                 box_colors.erase(box_colors.begin() + i);
+                continuous_bounds.erase(continuous_bounds.begin() + i);
                 Box& tmp_box = track.getBoxAtIndex(0);
                 bound_all.min = tmp_box.min;
                 bound_all.max = tmp_box.max;
@@ -157,6 +171,7 @@ public:
                     bound_all.enlargeTo(track.getBoxAtIndex(box_indices[i]).min);
                     bound_all.enlargeTo(track.getBoxAtIndex(box_indices[i]).max);
                 }
+                revision++;
                 return true;
             }
         }
@@ -168,17 +183,25 @@ public:
     {
         for(int i = 0; i < box_indices.size(); i++)
         {
-            track.getBoxAtIndex(box_indices[i]).setColor(box_colors[i]);
+            track.setBoxColor(box_indices[i], box_colors[i]);
         }
         box_indices.clear();
         box_colors.clear();
+        continuous_bounds.clear();
         bound_all = BBox();
+        revision++;
     }
     int getNumSelected() const
     {
         return box_indices.size();
     }
 
+    // Changes whenever the set of selected boxes or their bounds change
+    int getRevision() const
+    {
+        return revision;
+    }
+
     // NOTE temporary
     Box& getBox(const int index)
     {
@@ -189,6 +212,11 @@ public:
         //return nullptr;
     }
 
+    const Box& getBox(const int index) const
+    {
+        return track.getBoxAtIndex(box_indices[index]);
+    }
+
     Vec3 getCenter()
     {
         return bound_all.getCenter();
@@ -199,4 +227,7 @@ private:
     Vec3 selected_color;
     std::vector<int> box_indices;
     std::vector<Vec3> box_colors;
+    // Unsnapped bounds of each selected box while it is dragged or resized
+    std::vector<BBox> continuous_bounds;
+    int revision;
 };
@@ -1,9 +1,15 @@
 #version 150 core
 
 in vec3 normal_w_frag;
+in vec3 diffuse_color;
 
-uniform vec3 dir_light;
-uniform vec3 diffuse_color;
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
 
 out vec4 outColor;
 
@@ -11,7 +17,7 @@ void main()
 {
     //vec4 diffuse_color = vec4(0.7, 0.7, 0.7, 1.0);
     vec3 amb_contrib = diffuse_color * 0.2;
-    float cos_theta = clamp(dot(dir_light, normal_w_frag), 0, 1);
+    float cos_theta = clamp(dot(dir_light.xyz, normal_w_frag), 0, 1);
     vec3 diff_contrib;
     if(cos_theta < 0.0)
     {
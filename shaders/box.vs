@@ -2,15 +2,27 @@
 
 in vec3 position;
 in vec3 normal;
+// Per instance
+in vec3 instance_min;
+in vec3 instance_max;
+in vec3 instance_color;
 
-uniform mat4 view_mat;
-uniform mat4 normal_mat;
-uniform mat4 proj_mat;
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
 
 out vec3 normal_w_frag;
+out vec3 diffuse_color;
 
 void main()
 {
-    normal_w_frag = (normal_mat * vec4(normal, 0.0)).rgb;
-    gl_Position = proj_mat * view_mat * vec4(position, 1.0f);
+    // Boxes are only scaled and moved, so the cube normals are world space
+    normal_w_frag = normal;
+    diffuse_color = instance_color;
+    vec3 world_pos = instance_min + position * (instance_max - instance_min);
+    gl_Position = proj_mat * view_mat * vec4(world_pos, 1.0f);
 }	
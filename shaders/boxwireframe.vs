@@ -1,11 +1,20 @@
 #version 150 core
 
 in vec3 position;
+// Per instance
+in vec3 instance_min;
+in vec3 instance_max;
 
-uniform mat4 view_mat;
-uniform mat4 proj_mat;
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
 
 void main()
 {
-    gl_Position = proj_mat * view_mat * vec4(position, 1.0f);
+    vec3 world_pos = instance_min + position * (instance_max - instance_min);
+    gl_Position = proj_mat * view_mat * vec4(world_pos, 1.0f);
 }
\ No newline at end of file
@@ -2,8 +2,13 @@
 
 in vec3 position;
 
-uniform mat4 view_mat;
-uniform mat4 proj_mat;
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
 
 void main()
 {
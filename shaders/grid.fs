@@ -0,0 +1,33 @@
+#version 150 core
+
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
+
+in vec2 plane_pos;
+in vec3 world_pos;
+
+out vec4 outColor;
+
+uniform vec3 color;
+uniform float spacing;
+uniform float extent;
+
+void main()
+{
+    vec2 coord = plane_pos / spacing;
+    // Distance to the nearest line in pixels, fwidth keeps lines one pixel wide at any distance
+    vec2 line_dist = abs(fract(coord - 0.5f) - 0.5f) / fwidth(coord);
+    float line = 1.0f - min(min(line_dist.x, line_dist.y), 1.0f);
+    float fade = 1.0f - smoothstep(0.5f * extent, extent, length(world_pos - camera_pos.xyz));
+    float alpha = 0.5f * line * fade;
+    if(alpha <= 0.0f)
+    {
+        discard;
+    }
+    outColor = vec4(color, alpha);
+}
@@ -0,0 +1,28 @@
+#version 150 core
+
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
+
+// The grid lies in the xz plane of model_mat, which only rotates and moves
+uniform mat4 model_mat;
+// Half the side of the quad, past it the grid has faded out
+uniform float extent;
+
+out vec2 plane_pos;
+out vec3 world_pos;
+
+void main()
+{
+    // Corners of a triangle strip quad from the vertex index, no vertex buffer
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0f - 1.0f;
+    // Centered under the camera so the grid never ends
+    vec3 camera_plane_pos = transpose(mat3(model_mat)) * (camera_pos.xyz - model_mat[3].xyz);
+    plane_pos = camera_plane_pos.xz + corner * extent;
+    world_pos = (model_mat * vec4(plane_pos.x, 0.0f, plane_pos.y, 1.0f)).xyz;
+    gl_Position = proj_mat * view_mat * vec4(world_pos, 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 150 core
+
+in vec3 position;
+
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
+
+uniform mat4 model_mat;
+
+void main()
+{
+    gl_Position = proj_mat * view_mat * model_mat * vec4(position, 1.0f);
+}
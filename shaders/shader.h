@@ -4,6 +4,19 @@
 #include <sstream>
 #include <fstream>
 
+// Uniform buffer binding points shared by every program
+const GLuint FRAME_UNIFORMS_BINDING = 0;
+
+// Point the program's FrameUniforms block, if it uses one, at its binding
+static void bindUniformBlocks(const GLuint shader_program)
+{
+    GLuint block_index = glGetUniformBlockIndex(shader_program, "FrameUniforms");
+    if(block_index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(shader_program, block_index, FRAME_UNIFORMS_BINDING);
+    }
+}
+
 static GLuint loadShader(const char *file_path, const GLenum shader_type)
 {
 	GLuint shader = glCreateShader(shader_type);
@@ -51,6 +64,7 @@ static GLuint loadAndLinkShaders(const char* vert_shader_path, const char* frag_
     glAttachShader(shader_program, frag_shader);
     glBindFragDataLocation(shader_program, 0, "outColor");
     glLinkProgram(shader_program);
+    bindUniformBlocks(shader_program);
     glDeleteShader(frag_shader);
     glDeleteShader(vert_shader);
     return shader_program;
@@ -0,0 +1,249 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../mat.h"
+#include "../vec.h"
+#include "../glstate.h"
+#include "shader.h"
+
+/*
+  Typed handles to a uniform or vertex attribute of a program
+  A location of -1 means the program doesn't use it, GL ignores uniform calls on
+  -1 so the handle can still be set.
+ */
+template<typename T>
+struct Uniform
+{
+    Uniform()
+        :location(-1)
+    {
+    }
+    GLint location;
+};
+
+struct Attrib
+{
+    Attrib()
+        :location(-1)
+    {
+    }
+    bool isActive() const
+    {
+        return location != -1;
+    }
+    GLint location;
+};
+
+static void setUniform(const Uniform<Mat4>& uniform, const Mat4& m)
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_TRUE, &(m.data[0][0]));
+}
+
+static void setUniform(const Uniform<Vec3>& uniform, const Vec3& v)
+{
+    glUniform3fv(uniform.location, 1, (const GLfloat*)(v.data));
+}
+
+static void setUniform(const Uniform<float>& uniform, const float f)
+{
+    glUniform1f(uniform.location, f);
+}
+
+// Also samplers, set to a texture unit
+static void setUniform(const Uniform<int>& uniform, const int i)
+{
+    glUniform1i(uniform.location, i);
+}
+
+/*
+  Compiles each vertex and fragment shader pair once and owns the programs
+  After linking, every active uniform and attribute is read with glGetActiveUniform
+  and glGetActiveAttrib, so getting a handle is a lookup in that table with a type
+  check instead of a call into GL. Get handles when creating things, per frame
+  code only sets them.
+ */
+class ShaderRegistry
+{
+public:
+    ShaderRegistry()
+    {
+    }
+
+    ShaderRegistry(const ShaderRegistry&) = delete;
+    ShaderRegistry& operator=(const ShaderRegistry&) = delete;
+
+    // Returns the already linked program if this pair was loaded before
+    GLuint getProgram(const char* vert_shader_path, const char* frag_shader_path)
+    {
+        for(int i = 0; i < programs.size(); i++)
+        {
+            if(programs[i].vert_shader_path == vert_shader_path && programs[i].frag_shader_path == frag_shader_path)
+            {
+                return programs[i].program;
+            }
+        }
+        programs.push_back(ProgramInfo());
+        ProgramInfo& info = programs.back();
+        info.vert_shader_path = vert_shader_path;
+        info.frag_shader_path = frag_shader_path;
+        info.program = loadAndLinkShaders(vert_shader_path, frag_shader_path);
+        reflect(info);
+        return info.program;
+    }
+
+    template<typename T>
+    Uniform<T> getUniform(const GLuint program, const char* name) const
+    {
+        Uniform<T> uniform;
+        const Variable* variable = findVariable(program, name, false);
+        if(!variable)
+        {
+            // Not active, either misspelled or optimized out
+            return uniform;
+        }
+        if(!uniformTypeMatches(variable->type, (const T*)nullptr))
+        {
+            fprintf(stderr, "Uniform %s has GL type 0x%x, which doesn't match its handle\n", name, variable->type);
+            return uniform;
+        }
+        uniform.location = variable->location;
+        return uniform;
+    }
+
+    Attrib getAttrib(const GLuint program, const char* name) const
+    {
+        Attrib attrib;
+        const Variable* variable = findVariable(program, name, true);
+        if(variable)
+        {
+            attrib.location = variable->location;
+        }
+        return attrib;
+    }
+
+    int getNumPrograms() const
+    {
+        return programs.size();
+    }
+
+    // Call while the GL context still exists
+    void deleteAll()
+    {
+        for(int i = 0; i < programs.size(); i++)
+        {
+            g_gl_state.deleteProgram(programs[i].program);
+        }
+        programs.clear();
+    }
+
+private:
+    struct Variable
+    {
+        std::string name;
+        GLenum type;
+        GLint location;
+    };
+
+    struct ProgramInfo
+    {
+        std::string vert_shader_path;
+        std::string frag_shader_path;
+        GLuint program;
+        std::vector<Variable> uniforms;
+        std::vector<Variable> attribs;
+    };
+
+    static void reflect(ProgramInfo& info)
+    {
+        GLint num_uniforms = 0, num_attribs = 0;
+        glGetProgramiv(info.program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+        glGetProgramiv(info.program, GL_ACTIVE_ATTRIBUTES, &num_attribs);
+        GLchar name[256];
+        for(int i = 0; i < num_uniforms; i++)
+        {
+            GLsizei length;
+            GLint size;
+            Variable variable;
+            glGetActiveUniform(info.program, i, sizeof(name), &length, &size, &(variable.type), name);
+            variable.location = glGetUniformLocation(info.program, name);
+            // Members of uniform blocks like FrameUniforms have no location
+            if(variable.location == -1)
+            {
+                continue;
+            }
+            variable.name = stripArraySuffix(name);
+            info.uniforms.push_back(variable);
+        }
+        for(int i = 0; i < num_attribs; i++)
+        {
+            GLsizei length;
+            GLint size;
+            Variable variable;
+            glGetActiveAttrib(info.program, i, sizeof(name), &length, &size, &(variable.type), name);
+            variable.location = glGetAttribLocation(info.program, name);
+            variable.name = name;
+            info.attribs.push_back(variable);
+        }
+    }
+
+    // Active arrays are reported as name[0]
+    static std::string stripArraySuffix(const char* name)
+    {
+        std::string result(name);
+        size_t bracket = result.find('[');
+        if(bracket != std::string::npos)
+        {
+            result.resize(bracket);
+        }
+        return result;
+    }
+
+    const Variable* findVariable(const GLuint program, const char* name, const bool attrib) const
+    {
+        for(int i = 0; i < programs.size(); i++)
+        {
+            if(programs[i].program != program)
+            {
+                continue;
+            }
+            const std::vector<Variable>& variables = attrib ? programs[i].attribs : programs[i].uniforms;
+            for(int j = 0; j < variables.size(); j++)
+            {
+                if(variables[j].name == name)
+                {
+                    return &(variables[j]);
+                }
+            }
+            return nullptr;
+        }
+        fprintf(stderr, "Program %u wasn't loaded through the shader registry\n", program);
+        return nullptr;
+    }
+
+    static bool uniformTypeMatches(const GLenum type, const Mat4*)
+    {
+        return type == GL_FLOAT_MAT4;
+    }
+
+    static bool uniformTypeMatches(const GLenum type, const Vec3*)
+    {
+        return type == GL_FLOAT_VEC3;
+    }
+
+    static bool uniformTypeMatches(const GLenum type, const float*)
+    {
+        return type == GL_FLOAT;
+    }
+
+    static bool uniformTypeMatches(const GLenum type, const int*)
+    {
+        return type == GL_INT || type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE;
+    }
+
+    std::vector<ProgramInfo> programs;
+};
+
+// Defined in main.cpp
+extern ShaderRegistry g_shaders;
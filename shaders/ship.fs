@@ -6,13 +6,19 @@ in vec3 normal_w_frag;
 uniform sampler2D diffuse_map;
 uniform sampler2D normal_map;
 
-uniform vec3 dir_light;
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
 
 out vec4 outColor;
 
 void main()
 {
     vec4 diffuse_color = texture(diffuse_map, texcoord_frag);
-	outColor = diffuse_color * dot(dir_light, normalize(normal_w_frag));
+	outColor = diffuse_color * dot(dir_light.xyz, normalize(normal_w_frag));
 }
 
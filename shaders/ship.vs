@@ -4,10 +4,16 @@ in vec3 position;
 in vec3 normal;
 in vec2 texcoord;
 
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
+
 uniform mat4 model_mat;
-uniform mat4 view_mat;
 uniform mat4 normal_mat;
-uniform mat4 proj_mat;
 
 out vec2 texcoord_frag;
 out vec3 normal_w_frag;
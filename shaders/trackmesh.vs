@@ -0,0 +1,24 @@
+#version 150 core
+
+in vec3 position;
+in vec3 normal;
+in vec3 color;
+
+layout(std140, row_major) uniform FrameUniforms
+{
+    mat4 view_mat;
+    mat4 proj_mat;
+    vec4 dir_light;
+    vec4 camera_pos;
+};
+
+out vec3 normal_w_frag;
+out vec3 diffuse_color;
+
+void main()
+{
+    // The mesh is built in world space
+    normal_w_frag = normal;
+    diffuse_color = color;
+    gl_Position = proj_mat * view_mat * vec4(position, 1.0f);
+}
@@ -6,17 +6,9 @@
 #include <vector>
 #include "texture.h"
 #include "shaders/shader.h"
-#define OBJ_LOADER_IMPLEMENTATION
 #include "objloader/objloader.h"
 #include "mat.h"
 
-// Ship velocity constants
-const float MAX_Z_VELOCITY = 30.0f;
-const float MAX_X_VELOCITY = 5.0f;
-const float MAX_Y_DOWNWARD_VELOCITY = -85.0f;
-const float Y_JUMP_VELOCITY = 25.0f;
-const float JUMPABLE_TIME_AFTER_NOT_GROUNDED = 0.1f;
-
 Ship::Ship()
 {
     std::string model_base_path("models/");    
@@ -27,7 +19,7 @@ Ship::Ship()
     int num_shapes, num_mat;
     loadOBJ(&obj_shapes, &obj_materials, &num_shapes, &num_mat, model_file_path.c_str());
 
-    bbox = BBox(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-TMAX, -TMAX, -TMAX));
+    BBox model_bbox(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-TMAX, -TMAX, -TMAX));
 
     OBJShape *ship_obj = &(obj_shapes[0]);
     std::vector<GLfloat> ship_vert_data;
@@ -35,7 +27,7 @@ Ship::Ship()
     std::cout << "num_normals: " << ship_obj->num_normals << std::endl;
     std::cout << "num_texcoords: " << ship_obj->num_texcoords << std::endl;
     ship_vert_data.reserve(ship_obj->num_positions + ship_obj->num_normals + ship_obj->num_texcoords);
-    const float scale = 0.2f;
+    const float scale = SHIP_MODEL_SCALE;
     for(int i = 0; i < ship_obj->num_positions/3; i++)
     {
         Vec3 scaled_pos(ship_obj->positions[i*3] * scale, ship_obj->positions[i*3 + 1] * scale,
@@ -48,85 +40,43 @@ Ship::Ship()
         ship_vert_data.push_back(ship_obj->normals[i*3 + 2]);
         ship_vert_data.push_back(ship_obj->texcoords[i*2]);
         ship_vert_data.push_back(-ship_obj->texcoords[i*2 + 1]);
-        bbox.enlargeTo(scaled_pos);
+        model_bbox.enlargeTo(scaled_pos);
     }
+    initFromModelBBox(model_bbox);
         
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    g_gl_state.bindVertexArray(vao);
 
     glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    g_gl_state.bindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * ship_vert_data.size(),
                  &(ship_vert_data[0]), GL_STATIC_DRAW);
 
     glGenBuffers(1, &ibo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    g_gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLint) * ship_obj->num_indices, ship_obj->indices,
                  GL_STATIC_DRAW);
     num_indices = ship_obj->num_indices;
 
-    // Textures
-    Texture ship_diffuse_tex("models/Ship2_diffuse.png");
-    Texture ship_normal_tex("models/Ship2_Normal.png");
-
-    glGenTextures(1, &diffuse_map);
-    glGenTextures(1, &normal_map);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuse_map);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ship_diffuse_tex.width, ship_diffuse_tex.height, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, ship_diffuse_tex.data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normal_map);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, ship_normal_tex.width, ship_normal_tex.height, 0, GL_RGB,
-                 GL_UNSIGNED_BYTE, ship_normal_tex.data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Textures, cooked with mipmaps by tools/texcook.cpp
+    diffuse_map = loadTexture2D("models/Ship2_diffuse.tex", "models/Ship2_diffuse.png");
+    normal_map = loadTexture2D("models/Ship2_Normal.tex", "models/Ship2_Normal.png");
 
     // Shaders
-    std::ifstream vert_fstream("shaders/ship.vs");
-    std::stringstream buffer;
-    buffer << vert_fstream.rdbuf();
-    vert_fstream.close();
-    std::string vert_src = buffer.str();
-    const char* vert_src_cstr = vert_src.c_str();    
-    GLuint vert_shader = loadShader(vert_src_cstr, GL_VERTEX_SHADER);
-
-    std::ifstream frag_fstream("shaders/ship.fs");
-    buffer.str("");
-    buffer << frag_fstream.rdbuf();
-    std::string frag_src = buffer.str();
-    const char* frag_src_cstr = frag_src.c_str();
-    GLuint frag_shader = loadShader(frag_src_cstr, GL_FRAGMENT_SHADER);
-
-    shader_program = glCreateProgram();
-    glAttachShader(shader_program, vert_shader);
-    glAttachShader(shader_program, frag_shader);
-    glBindFragDataLocation(shader_program, 0, "outColor");
-    glLinkProgram(shader_program);
-    glUseProgram(shader_program);
-    glDeleteShader(frag_shader);
-    glDeleteShader(vert_shader);
+    shader_program = g_shaders.getProgram("shaders/ship.vs", "shaders/ship.fs");
+    g_gl_state.useProgram(shader_program);
 
     // Setting attributes
     GLsizei stride = sizeof(GLfloat) * 8; // 3 pos + 3 pos + 2 texcoord 
-    GLint posAttrib = glGetAttribLocation(shader_program, "position");
+    GLint posAttrib = g_shaders.getAttrib(shader_program, "position").location;
     glEnableVertexAttribArray(posAttrib);
     glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, stride, 0);
 
-    GLint normAttrib = glGetAttribLocation(shader_program, "normal");
+    GLint normAttrib = g_shaders.getAttrib(shader_program, "normal").location;
     glEnableVertexAttribArray(normAttrib);
     glVertexAttribPointer(normAttrib, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(GLfloat) * 3));
 
-    GLint texcoordAttrib = glGetAttribLocation(shader_program, "texcoord");
+    GLint texcoordAttrib = g_shaders.getAttrib(shader_program, "texcoord").location;
     glEnableVertexAttribArray(texcoordAttrib);
     glVertexAttribPointer(texcoordAttrib, 2, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(GLfloat) * 6));
 
@@ -135,270 +85,49 @@ Ship::Ship()
         OBJShape_destroy(&(obj_shapes[i]));
     }
     // Get shader uniform handles
-    u_model_mat = glGetUniformLocation(shader_program, "model_mat");
-    u_view_mat = glGetUniformLocation(shader_program, "view_mat");
-    u_normal_mat = glGetUniformLocation(shader_program, "normal_mat");
-
-    // Center the ship
-    Vec3 bbox_center = (bbox.max - bbox.min) * 0.5 + bbox.min;
-    Mat4 translation = Mat4::makeTranslation(-bbox_center);
-    // Initial rotation for pointing the ship at -z
-    Mat4 rotation = Mat4::makeYRotation(180.0f) * Mat4::makeXRotation(90.0f);
-    transform = rotation * translation;
-    default_ship_transform = transform;
-    bbox.transform(transform);
-    glUniformMatrix4fv(u_model_mat, 1, GL_TRUE, &(transform.data[0][0]));
+    u_model_mat = g_shaders.getUniform<Mat4>(shader_program, "model_mat");
+    u_normal_mat = g_shaders.getUniform<Mat4>(shader_program, "normal_mat");
 
-    glUseProgram(0);
-    glBindVertexArray(0);
+    setUniform(u_model_mat, transform);
 
-    grounded = false;
+    g_gl_state.useProgram(0);
+    g_gl_state.bindVertexArray(0);
 }
 
 Ship::~Ship()
 {
-    glDeleteProgram(shader_program);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &ibo);
-    glDeleteVertexArrays(1, &vao);
-    glDeleteTextures(1, &diffuse_map);
-    glDeleteTextures(1, &normal_map);
+    g_gl_state.deleteBuffer(vbo);
+    g_gl_state.deleteBuffer(ibo);
+    g_gl_state.deleteVertexArray(vao);
+    g_gl_state.deleteTexture(diffuse_map);
+    g_gl_state.deleteTexture(normal_map);
 }
 
-void Ship::setStaticUniforms(const Mat4& proj_transform, const Vec3& dir_light)
+void Ship::setStaticUniforms()
 {
-    glUseProgram(shader_program);
-    GLint u_proj_mat = glGetUniformLocation(shader_program, "proj_mat");
-    glUniformMatrix4fv(u_proj_mat, 1, GL_TRUE, &(proj_transform.data[0][0]));
-    
-    GLint u_diffuse_map = glGetUniformLocation(shader_program, "diffuse_map");
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuse_map);
-    glUniform1i(u_diffuse_map, 0);
-    GLint u_dir_light = glGetUniformLocation(shader_program, "dir_light");
-    glUniform3fv(u_dir_light, 1, (const GLfloat*)(dir_light.data));
-    glUseProgram(0);
+    g_gl_state.useProgram(shader_program);
+    g_gl_state.bindTexture2D(0, diffuse_map);
+    setUniform(g_shaders.getUniform<int>(shader_program, "diffuse_map"), 0);
 }
 
 // Called after ship velocity and position are resolved
-void Ship::updateDynamicUniforms(const Mat4& view_transform) const
-{
-    Mat4 normal_transform = (view_transform * this->transform.inverse()).transpose();
-    glUseProgram(shader_program);
-    glUniformMatrix4fv(u_normal_mat, 1, GL_TRUE, &(normal_transform.data[0][0]));
-    glUniformMatrix4fv(u_model_mat, 1, GL_TRUE, &(transform.data[0][0]));
-    glUniformMatrix4fv(u_view_mat, 1, GL_TRUE, &(view_transform.data[0][0]));
-    glUseProgram(0);
-}
-
-bool Ship::bboxCollide(const BBox& bbox) const
-{
-    return bbox.bboxIntersect(bbox);
-}
-
-void Ship::setViewTransform(const Mat4& view_transform) const
-{
-    glUseProgram(shader_program);
-    GLint view_handle = glGetUniformLocation(shader_program, "view_mat");
-    glUniformMatrix4fv(view_handle, 1, GL_TRUE, &(view_transform.data[0][0]));
-    glUseProgram(0);
-}
-
-void Ship::setProjTransform(const Mat4& proj_transform) const
-{
-    glUseProgram(shader_program);
-    GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-    glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-    glUseProgram(0);
-}
-
-BBox Ship::getBBox()
-{
-    return bbox;
-}
-
-void Ship::draw() const
-{
-    glBindVertexArray(vao);
-    glUseProgram(shader_program);
-    glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
-}
-
-void Ship::updatePosAndVelocity(const float dt, Track& track)
-{
-    Vec3 dp;
-    BBox new_bbox(bbox);
-    if(velocity[0] != 0.0f || velocity[1] != 0.0f || velocity[2] != 0.0f)
-    {
-        dp = velocity * dt;
-        new_bbox.min += dp;
-        new_bbox.max += dp;
-    }
-
-    int collided = track.bboxCollideWithTrack(colliding_boxes, new_bbox);
-    bool tmp_grounded = false;
-    for(int i = 0; collided > 0 && i < 3; i++)
-    {
-        int hit_dir = -1;
-        float overlap_time = -HUGEVALUE;
-
-        for(int i = 0; i < collided; i++)
-        {
-            Box* track_box = colliding_boxes[i];
-            int tmp_hit_dir;
-            float tmp_overlap_time = new_bbox.calcOverlapTime(tmp_hit_dir, track_box, velocity);
-            if(tmp_hit_dir == 2)
-            {
-                tmp_grounded = true;
-            }
-            if(tmp_overlap_time > overlap_time)
-            {
-                overlap_time = tmp_overlap_time;
-                hit_dir = tmp_hit_dir;
-            }
-        }
-        if(overlap_time > -HUGEVALUE)
-        {
-            //printf("dt %f\n", dt);
-            //printf("overlap_time %f\n", overlap_time);
-            dp = velocity * (dt - overlap_time - (dt * 0.05f));
-            velocity[hit_dir/2] = 0.0f; // hit_dir can take on values from 0-5
-            dp += velocity * (overlap_time + (dt * 0.05f));
-        }
-        new_bbox.min = bbox.min + dp;
-        new_bbox.max = bbox.max + dp;
-        collided = track.bboxCollideWithTrack(colliding_boxes, new_bbox);
-    }
-    if(tmp_grounded)
-    {
-        jumping = false;
-    }
-    if(!tmp_grounded)
-    {
-        if(grounded)
-        {
-            time_not_grounded = 0.0f;
-        }else
-        {
-            time_not_grounded += dt;
-        }
-    }
-    grounded = tmp_grounded;
-    bbox.min += dp;
-    bbox.max += dp;
-    Mat4 displacement = Mat4::makeTranslation(dp);
-    transform = displacement * transform;
-}
-
-void Ship::calcVelocity(int accel_states[3], const float dt)
-{
-    float z_forward_accel = -MAX_Z_VELOCITY / 0.5f;
-    // Z velocity
-    // Ship going "forward"
-    if(velocity[2] < 0.0f)
-    {
-        if(accel_states[2] == -1)
-        {
-            // Accelerating in the same direction as ship motion
-            velocity[2] += z_forward_accel * dt;
-            if(velocity[2] < -MAX_Z_VELOCITY)
-            {
-                velocity[2] = -MAX_Z_VELOCITY;
-            }
-        }else if(accel_states[2] == 1)
-        {
-            // Acclerating in the opposite direction as ship motion
-            velocity[2] += 5.0f;
-        }else
-        {
-            // Slowing down to 0
-            velocity[2] += 3.0f;
-            if(velocity[2] >= 0.0f)
-            {
-                velocity[2] = 0.0f;
-            }
-        }
-    }else if(velocity[2] > 0.0f)
-    {
-        if(accel_states[2] == -1)
-        {
-            // Accelerating in the opposite direction as ship motion
-            velocity[2] -= 5.0;
-        }else if(accel_states[2] == 1)
-        {
-            // Acclerating in the same direction as ship motion
-            velocity[2] = MAX_Z_VELOCITY;
-        }else
-        {
-            // Slowing down to 0
-            velocity[2] -= 3.0f;
-            if(velocity[2] < 0.0f)
-            {
-                velocity[2] = 0.0f;
-            }
-        }        
-    }else if(velocity[2] == 0)
-    {
-        if(accel_states[2] == -1)
-        {
-            // Forward
-            //velocity[2] = -MAX_Z_VELOCITY;
-            velocity[2] += z_forward_accel * dt;
-        }else if(accel_states[2] == 1)
-        {
-            // Backward
-            velocity[2] = MAX_Z_VELOCITY;
-        }
-    }
-
-    // X velocity
-    if(accel_states[0] == -1)
-    {
-        velocity[0] = -MAX_X_VELOCITY;
-    }else if(accel_states[0] == 1)
-    {
-        velocity[0] = MAX_X_VELOCITY;
-    }else if(accel_states[0] == 0)
-    {
-        velocity[0] = 0;
-    }
-
-    // Y velocity
-    float y_accel = MAX_Y_DOWNWARD_VELOCITY / 0.1f;
-    if(accel_states[1] == -1)
-    {
-        velocity[1] += MAX_Y_DOWNWARD_VELOCITY * dt;
-        if(velocity[1] < MAX_Y_DOWNWARD_VELOCITY)
-        {
-            velocity[1] = MAX_Y_DOWNWARD_VELOCITY;
-        }
-    }else if(accel_states[1] == 1 && !jumping &&
-             (grounded || time_not_grounded < JUMPABLE_TIME_AFTER_NOT_GROUNDED))
-    {
-        velocity[1] = Y_JUMP_VELOCITY;
-        grounded = false;
-        jumping = true;
-    }
-}
-
-void Ship::move(const Vec3& v)
+// Normals go to world space, where dir_light is
+void Ship::updateDynamicUniforms() const
 {
-    Mat4 translation = Mat4::makeTranslation(v);
-    transform = translation * transform;
-    bbox.min += v;
-    bbox.max += v;
+    Mat4 normal_transform = this->transform.inverse().transpose();
+    g_gl_state.useProgram(shader_program);
+    setUniform(u_normal_mat, normal_transform);
+    setUniform(u_model_mat, transform);
 }
 
-Vec3 Ship::getPos() const
+void Ship::submit(RenderQueue& queue) const
 {
-    return Vec3(transform(0, 3), transform(1, 3), transform(2, 3));
+    float depth = queue.calcDepth(Vec3(transform.getColumn(3)));
+    queue.submit(PASS_OPAQUE, shader_program, vao, diffuse_map, depth, drawMesh, this, 0, num_indices);
 }
 
-void Ship::resetPosition()
+// The queue binds the program, vertex array and diffuse_map
+void Ship::drawMesh(const DrawItem& item)
 {
-    Vec3 ship_pos = this->getPos();
-    bbox.min -= ship_pos;
-    bbox.max -= ship_pos;
-    transform = default_ship_transform;
+    g_gl_state.drawElements(GL_TRIANGLES, item.count, GL_UNSIGNED_INT, 0);
 }
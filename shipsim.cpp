@@ -0,0 +1,299 @@
+#include "shipsim.h"
+#include <vector>
+#define OBJ_LOADER_IMPLEMENTATION
+#include "objloader/objloader.h"
+#include <algorithm>
+
+// Ship velocity constants
+const float MAX_Z_VELOCITY = 30.0f;
+const float MAX_X_VELOCITY = 5.0f;
+const float MAX_Y_DOWNWARD_VELOCITY = -85.0f;
+const float Y_JUMP_VELOCITY = 25.0f;
+const float JUMPABLE_TIME_AFTER_NOT_GROUNDED = 0.1f;
+
+// Collision constants
+const int MAX_COLLISION_PASSES = 3;
+// Distance kept between the ship and a box it runs into
+const float COLLISION_SKIN = 0.001f;
+// Overlap with a box at the start of a move that still counts as touching it
+const float MAX_START_PENETRATION = 0.01f;
+
+ShipSim::ShipSim()
+    :swept_box_indices(MIN_SWEPT_BOXES), grounded(false), jumping(false), time_not_grounded(0.0f)
+{
+    bbox = BBox(Vec3(-0.5f, -0.5f, -0.5f), Vec3(0.5f, 0.5f, 0.5f));
+}
+
+ShipSim::ShipSim(const BBox& model_bbox)
+    :swept_box_indices(MIN_SWEPT_BOXES), grounded(false), jumping(false), time_not_grounded(0.0f)
+{
+    initFromModelBBox(model_bbox);
+}
+
+BBox ShipSim::loadModelBBox(const char* file_name)
+{
+    OBJShape *obj_shapes;
+    OBJMaterial *obj_materials;
+    int num_shapes, num_mat;
+    BBox model_bbox(Vec3(FLT_MAX, FLT_MAX, FLT_MAX), Vec3(-TMAX, -TMAX, -TMAX));
+    if(!loadOBJ(&obj_shapes, &obj_materials, &num_shapes, &num_mat, file_name) || num_shapes == 0)
+    {
+        return BBox(Vec3(-0.5f, -0.5f, -0.5f), Vec3(0.5f, 0.5f, 0.5f));
+    }
+    const OBJShape *ship_obj = &(obj_shapes[0]);
+    for(int i = 0; i < ship_obj->num_positions/3; i++)
+    {
+        model_bbox.enlargeTo(Vec3(ship_obj->positions[i*3] * SHIP_MODEL_SCALE,
+                                  ship_obj->positions[i*3 + 1] * SHIP_MODEL_SCALE,
+                                  ship_obj->positions[i*3 + 2] * SHIP_MODEL_SCALE));
+    }
+    for(int i = 0; i < num_shapes; ++i)
+    {
+        OBJShape_destroy(&(obj_shapes[i]));
+    }
+    free(obj_shapes);
+    free(obj_materials);
+    return model_bbox;
+}
+
+void ShipSim::initFromModelBBox(const BBox& model_bbox)
+{
+    bbox = model_bbox;
+    // Center the ship
+    Vec3 bbox_center = (bbox.max - bbox.min) * 0.5 + bbox.min;
+    Mat4 translation = Mat4::makeTranslation(-bbox_center);
+    // Initial rotation for pointing the ship at -z
+    Mat4 rotation = Mat4::makeYRotation(180.0f) * Mat4::makeXRotation(90.0f);
+    transform = rotation * translation;
+    default_ship_transform = transform;
+    bbox.transform(transform);
+}
+
+bool ShipSim::bboxCollide(const BBox& bbox) const
+{
+    return bbox.bboxIntersect(bbox);
+}
+
+BBox ShipSim::getBBox()
+{
+    return bbox;
+}
+
+/*
+  Swept AABB collision
+  The track is queried once for the boxes overlapping the bbox swept over the whole frame.
+  A query that fills the index buffer may have dropped boxes, so it grows and asks again.
+  Zeroing velocity components only ever shrinks the rest of the move, so the ship stays
+  inside that swept volume and later passes don't need to query again.
+  Each pass sorts the contacts by time of impact, moves the ship up to the first one,
+  zeroes the velocity along every axis hit at that time, and continues with the time left.
+ */
+void ShipSim::updatePosAndVelocity(const float dt, Track& track)
+{
+    Vec3 dp = velocity * dt;
+    BBox swept_bbox(bbox);
+    for(int i = 0; i < 3; i++)
+    {
+        if(dp[i] < 0.0f)
+        {
+            swept_bbox.min[i] += dp[i];
+        }else
+        {
+            swept_bbox.max[i] += dp[i];
+        }
+    }
+    int num_boxes = track.bboxQueryTrack(&(swept_box_indices[0]), swept_box_indices.size(), swept_bbox);
+    while(num_boxes == (int)swept_box_indices.size())
+    {
+        swept_box_indices.resize(swept_box_indices.size() * 2);
+        num_boxes = track.bboxQueryTrack(&(swept_box_indices[0]), swept_box_indices.size(), swept_bbox);
+    }
+    if(contacts.size() < swept_box_indices.size())
+    {
+        contacts.resize(swept_box_indices.size());
+    }
+    BBox moved_bbox(bbox);
+    Vec3 total_dp;
+    float time_left = dt;
+    bool tmp_grounded = false;
+    for(int pass = 0; pass < MAX_COLLISION_PASSES && time_left > 0.0f; pass++)
+    {
+        Vec3 pass_dp = velocity * time_left;
+        if(pass_dp[0] == 0.0f && pass_dp[1] == 0.0f && pass_dp[2] == 0.0f)
+        {
+            break;
+        }
+        int num_contacts = 0;
+        for(int i = 0; i < num_boxes; i++)
+        {
+            const Box& track_box = track.getBoxAtIndex(swept_box_indices[i]);
+            int axis;
+            float toi = moved_bbox.calcSweptImpactTime(axis, track_box, pass_dp, MAX_START_PENETRATION);
+            if(toi != TMAX)
+            {
+                contacts[num_contacts].toi = toi;
+                contacts[num_contacts].axis = axis;
+                contacts[num_contacts].box = swept_box_indices[i];
+                num_contacts++;
+            }
+        }
+        if(num_contacts == 0)
+        {
+            total_dp += pass_dp;
+            break;
+        }
+        std::sort(contacts.begin(), contacts.begin() + num_contacts);
+
+        // Stop just short of the first contact
+        const SweptContact& first = contacts[0];
+        float skin_time = COLLISION_SKIN / fabs(pass_dp[first.axis]);
+        float move_time = first.toi - skin_time > 0.0f ? first.toi - skin_time : 0.0f;
+        Vec3 step = pass_dp * move_time;
+        total_dp += step;
+        moved_bbox.min += step;
+        moved_bbox.max += step;
+        time_left *= 1.0f - first.toi;
+
+        // Every box hit at the same time stops the ship along its axis
+        for(int i = 0; i < num_contacts && contacts[i].toi <= first.toi; i++)
+        {
+            int axis = contacts[i].axis;
+            if(axis == 1 && velocity[1] < 0.0f)
+            {
+                tmp_grounded = true;
+            }
+            velocity[axis] = 0.0f;
+        }
+    }
+    if(tmp_grounded)
+    {
+        jumping = false;
+    }
+    if(!tmp_grounded)
+    {
+        if(grounded)
+        {
+            time_not_grounded = 0.0f;
+        }else
+        {
+            time_not_grounded += dt;
+        }
+    }
+    grounded = tmp_grounded;
+    bbox.min += total_dp;
+    bbox.max += total_dp;
+    Mat4 displacement = Mat4::makeTranslation(total_dp);
+    transform = displacement * transform;
+}
+
+void ShipSim::calcVelocity(int accel_states[3], const float dt)
+{
+    float z_forward_accel = -MAX_Z_VELOCITY / 0.5f;
+    // Z velocity
+    // Ship going "forward"
+    if(velocity[2] < 0.0f)
+    {
+        if(accel_states[2] == -1)
+        {
+            // Accelerating in the same direction as ship motion
+            velocity[2] += z_forward_accel * dt;
+            if(velocity[2] < -MAX_Z_VELOCITY)
+            {
+                velocity[2] = -MAX_Z_VELOCITY;
+            }
+        }else if(accel_states[2] == 1)
+        {
+            // Acclerating in the opposite direction as ship motion
+            velocity[2] += 5.0f;
+        }else
+        {
+            // Slowing down to 0
+            velocity[2] += 3.0f;
+            if(velocity[2] >= 0.0f)
+            {
+                velocity[2] = 0.0f;
+            }
+        }
+    }else if(velocity[2] > 0.0f)
+    {
+        if(accel_states[2] == -1)
+        {
+            // Accelerating in the opposite direction as ship motion
+            velocity[2] -= 5.0;
+        }else if(accel_states[2] == 1)
+        {
+            // Acclerating in the same direction as ship motion
+            velocity[2] = MAX_Z_VELOCITY;
+        }else
+        {
+            // Slowing down to 0
+            velocity[2] -= 3.0f;
+            if(velocity[2] < 0.0f)
+            {
+                velocity[2] = 0.0f;
+            }
+        }        
+    }else if(velocity[2] == 0)
+    {
+        if(accel_states[2] == -1)
+        {
+            // Forward
+            //velocity[2] = -MAX_Z_VELOCITY;
+            velocity[2] += z_forward_accel * dt;
+        }else if(accel_states[2] == 1)
+        {
+            // Backward
+            velocity[2] = MAX_Z_VELOCITY;
+        }
+    }
+
+    // X velocity
+    if(accel_states[0] == -1)
+    {
+        velocity[0] = -MAX_X_VELOCITY;
+    }else if(accel_states[0] == 1)
+    {
+        velocity[0] = MAX_X_VELOCITY;
+    }else if(accel_states[0] == 0)
+    {
+        velocity[0] = 0;
+    }
+
+    // Y velocity
+    float y_accel = MAX_Y_DOWNWARD_VELOCITY / 0.1f;
+    if(accel_states[1] == -1)
+    {
+        velocity[1] += MAX_Y_DOWNWARD_VELOCITY * dt;
+        if(velocity[1] < MAX_Y_DOWNWARD_VELOCITY)
+        {
+            velocity[1] = MAX_Y_DOWNWARD_VELOCITY;
+        }
+    }else if(accel_states[1] == 1 && !jumping &&
+             (grounded || time_not_grounded < JUMPABLE_TIME_AFTER_NOT_GROUNDED))
+    {
+        velocity[1] = Y_JUMP_VELOCITY;
+        grounded = false;
+        jumping = true;
+    }
+}
+
+void ShipSim::move(const Vec3& v)
+{
+    Mat4 translation = Mat4::makeTranslation(v);
+    transform = translation * transform;
+    bbox.min += v;
+    bbox.max += v;
+}
+
+Vec3 ShipSim::getPos() const
+{
+    return Vec3(transform(0, 3), transform(1, 3), transform(2, 3));
+}
+
+void ShipSim::resetPosition()
+{
+    Vec3 ship_pos = this->getPos();
+    bbox.min -= ship_pos;
+    bbox.max -= ship_pos;
+    transform = default_ship_transform;
+}
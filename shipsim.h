@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include "mat.h"
+#include "bbox.h"
+#include "track.h"
+
+// Scale applied to the ship model's positions
+const float SHIP_MODEL_SCALE = 0.2f;
+
+/*
+  Ship physics without any rendering
+  Holds the ship's bbox, transform and velocity and steps them against a Track.
+  Needs no GL context, so it can run in tests, benchmarks and bench/headless.cpp.
+  Ship adds the model, textures and shaders on top.
+ */
+class ShipSim
+{
+public:
+    ShipSim();
+    // model_bbox is the bbox of the scaled ship model before it is centered and turned
+    explicit ShipSim(const BBox& model_bbox);
+    // Bbox of the scaled ship model in file_name, read without creating any GL objects
+    static BBox loadModelBBox(const char* file_name);
+    void move(const Vec3& v);
+    bool bboxCollide(const BBox& bbox) const;
+    BBox getBBox();    
+    void updatePosAndVelocity(const float dt, Track& track);
+    void calcVelocity(int accel_states[3], const float dt);
+    Vec3 getPos() const;
+    void resetPosition();
+
+    BBox bbox;
+    static const int MIN_SWEPT_BOXES = 128;
+    // Track boxes overlapping the bbox swept over one frame, grows until a query fits
+    std::vector<int> swept_box_indices;
+    Vec3 velocity;
+    Mat4 transform;
+    bool grounded, jumping;
+    float time_not_grounded;    
+protected:
+    void initFromModelBBox(const BBox& model_bbox);
+private:
+    struct SweptContact
+    {
+        float toi;
+        int axis;
+        int box;
+
+        bool operator<(const SweptContact& other) const
+        {
+            return toi < other.toi;
+        }
+    };
+
+    Mat4 default_ship_transform;
+    std::vector<SweptContact> contacts;     // One per swept box at most
+};
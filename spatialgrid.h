@@ -0,0 +1,243 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <math.h>
+#include "constants.h"
+#include "bbox.h"
+
+/*
+  Uniform spatial hash grid over axially aligned boxes
+  Cells are cell_size on each side and are keyed by their integer coordinates.
+  A box is listed in every cell its half open extent [min, max) covers, and a query
+  looks at the cells its closed extent [min, max] could share with such a box,
+  so boxes that only touch the query box are still reported, same as BBox::bboxIntersect.
+  Boxes covering more than MAX_CELLS_PER_BOX cells go in a separate list that every
+  query checks, so a few very long boxes can't blow up the cell map.
+ */
+class SpatialGrid
+{
+public:
+    static const int MAX_CELLS_PER_BOX = 256;
+
+    SpatialGrid(const float size = GRID_UNIT)
+        :cell_size(size), inv_cell_size(1.0f / size), query_stamp(0)
+    {
+    }
+
+    void clear()
+    {
+        cells.clear();
+        large_ids.clear();
+        bounds.clear();
+        in_grid.clear();
+        stamps.clear();
+        query_stamp = 0;
+    }
+
+    // id is the index of the box in the caller's array
+    void insert(const int id, const BBox& bbox)
+    {
+        if(id >= (int)bounds.size())
+        {
+            bounds.resize(id + 1);
+            in_grid.resize(id + 1, false);
+            stamps.resize(id + 1, 0);
+        }
+        bounds[id] = bbox;
+        in_grid[id] = true;
+
+        int lo[3], hi[3];
+        calcInsertRange(lo, hi, bbox);
+        if(isLarge(lo, hi))
+        {
+            large_ids.push_back(id);
+            return;
+        }
+        for(int x = lo[0]; x <= hi[0]; x++)
+        {
+            for(int y = lo[1]; y <= hi[1]; y++)
+            {
+                for(int z = lo[2]; z <= hi[2]; z++)
+                {
+                    cells[makeKey(x, y, z)].push_back(id);
+                }
+            }
+        }
+    }
+
+    void remove(const int id)
+    {
+        if(id < 0 || id >= (int)bounds.size() || !in_grid[id])
+        {
+            return;
+        }
+        in_grid[id] = false;
+
+        int lo[3], hi[3];
+        calcInsertRange(lo, hi, bounds[id]);
+        if(isLarge(lo, hi))
+        {
+            removeFromList(large_ids, id);
+            return;
+        }
+        for(int x = lo[0]; x <= hi[0]; x++)
+        {
+            for(int y = lo[1]; y <= hi[1]; y++)
+            {
+                for(int z = lo[2]; z <= hi[2]; z++)
+                {
+                    auto cell = cells.find(makeKey(x, y, z));
+                    if(cell == cells.end())
+                    {
+                        continue;
+                    }
+                    removeFromList(cell->second, id);
+                    if(cell->second.empty())
+                    {
+                        cells.erase(cell);
+                    }
+                }
+            }
+        }
+    }
+
+    // Write the ids of the boxes that intersect bbox into results
+    // Returns the number of ids written, which is at most max_results
+    int query(int* results, const int max_results, const BBox& bbox)
+    {
+        int count = 0;
+        if(bounds.empty())
+        {
+            return count;
+        }
+        // Boxes can span several cells, so stamp each one to report it only once
+        query_stamp++;
+        if(query_stamp == 0)
+        {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            query_stamp = 1;
+        }
+        for(int i = 0; i < large_ids.size() && count < max_results; i++)
+        {
+            testId(results, count, large_ids[i], bbox);
+        }
+
+        int lo[3], hi[3];
+        calcQueryRange(lo, hi, bbox);
+        for(int x = lo[0]; x <= hi[0]; x++)
+        {
+            for(int y = lo[1]; y <= hi[1]; y++)
+            {
+                for(int z = lo[2]; z <= hi[2]; z++)
+                {
+                    auto cell = cells.find(makeKey(x, y, z));
+                    if(cell == cells.end())
+                    {
+                        continue;
+                    }
+                    const std::vector<int>& ids = cell->second;
+                    for(int i = 0; i < ids.size(); i++)
+                    {
+                        if(count == max_results)
+                        {
+                            return count;
+                        }
+                        testId(results, count, ids[i], bbox);
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    int getNumCells() const
+    {
+        return cells.size();
+    }
+
+    float getCellSize() const
+    {
+        return cell_size;
+    }
+
+private:
+    int cellCoord(const float f) const
+    {
+        return (int)floorf(f * inv_cell_size);
+    }
+
+    void calcInsertRange(int lo[3], int hi[3], const BBox& bbox) const
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            lo[i] = cellCoord(bbox.min[i]);
+            hi[i] = (int)ceilf(bbox.max[i] * inv_cell_size) - 1;
+            if(hi[i] < lo[i])
+            {
+                hi[i] = lo[i];
+            }
+        }
+    }
+
+    void calcQueryRange(int lo[3], int hi[3], const BBox& bbox) const
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            lo[i] = (int)ceilf(bbox.min[i] * inv_cell_size) - 1;
+            hi[i] = cellCoord(bbox.max[i]);
+        }
+    }
+
+    static bool isLarge(const int lo[3], const int hi[3])
+    {
+        long long num_cells = 1;
+        for(int i = 0; i < 3; i++)
+        {
+            num_cells *= (long long)(hi[i] - lo[i] + 1);
+        }
+        return num_cells > MAX_CELLS_PER_BOX;
+    }
+
+    // 21 bits per axis, cell coordinates wrap past +-1M cells
+    static uint64_t makeKey(const int x, const int y, const int z)
+    {
+        const uint64_t mask = (1 << 21) - 1;
+        return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) | (((uint64_t)z & mask) << 42);
+    }
+
+    static void removeFromList(std::vector<int>& ids, const int id)
+    {
+        for(int i = 0; i < ids.size(); i++)
+        {
+            if(ids[i] == id)
+            {
+                ids[i] = ids.back();
+                ids.pop_back();
+                return;
+            }
+        }
+    }
+
+    void testId(int* results, int& count, const int id, const BBox& bbox)
+    {
+        if(stamps[id] == query_stamp)
+        {
+            return;
+        }
+        stamps[id] = query_stamp;
+        if(bbox.bboxIntersect(bounds[id]))
+        {
+            results[count++] = id;
+        }
+    }
+
+    float cell_size, inv_cell_size;
+    std::unordered_map<uint64_t, std::vector<int>> cells;
+    std::vector<int> large_ids;
+    std::vector<BBox> bounds;
+    std::vector<bool> in_grid;
+    std::vector<unsigned int> stamps;
+    unsigned int query_stamp;
+};
@@ -0,0 +1,199 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstring>
+#include "glstate.h"
+
+/*
+  Ring buffer for data that is written once and drawn in the same frame
+  The buffer is split into NUM_SEGMENTS segments, one per frame in flight. Writes
+  go to the current frame's segment and endFrame puts a fence after the frame's
+  commands and moves on to the next segment, waiting first if the GPU may still be
+  reading it. So nothing written is ever overwritten while in use and the driver
+  never has to synchronize or copy on our behalf.
+  With ARB_buffer_storage the buffer is mapped once, persistently and coherently,
+  and a write is a memcpy. Otherwise each write maps its range with
+  GL_MAP_UNSYNCHRONIZED_BIT, which is safe because of the fences. Growing the ring
+  orphans the old buffer, draws already issued keep using it.
+  Source vertex attributes from getBuffer() at the returned offset, or copy into a
+  static buffer with glCopyBufferSubData to keep data longer than a frame.
+ */
+class StreamBuffer
+{
+public:
+    static const int NUM_SEGMENTS = 3;
+    // Offsets are aligned for any vertex attribute and for std140 blocks
+    static const GLsizeiptr ALIGNMENT = 256;
+
+    // No GL calls until the first write, so it can be constructed before the context
+    StreamBuffer()
+        :buffer(0), mapped(nullptr), persistent(false), segment_size(0), segment(0), segment_offset(0),
+        num_stalls(0)
+    {
+        for(int i = 0; i < NUM_SEGMENTS; i++)
+        {
+            fences[i] = 0;
+        }
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Returns where in getBuffer() the size bytes of data were written
+    GLintptr write(const void* data, const GLsizeiptr size)
+    {
+        GLintptr offset;
+        void* dst = map(size, offset);
+        memcpy(dst, data, size);
+        unmap();
+        return offset;
+    }
+
+    // Returns memory for size bytes at offset in getBuffer(), call unmap after writing
+    void* map(const GLsizeiptr size, GLintptr& offset)
+    {
+        GLsizeiptr aligned_offset = (segment_offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        if(aligned_offset + size > segment_size)
+        {
+            grow(aligned_offset + size);
+            aligned_offset = segment_offset;
+        }
+        offset = segment * segment_size + aligned_offset;
+        segment_offset = aligned_offset + size;
+        if(persistent)
+        {
+            return mapped + offset;
+        }
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        return glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    }
+
+    void unmap()
+    {
+        if(!persistent)
+        {
+            g_gl_state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+    }
+
+    GLuint getBuffer() const
+    {
+        return buffer;
+    }
+
+    // Call once per frame after the last draw that reads from the ring
+    void endFrame()
+    {
+        if(!buffer)
+        {
+            return;
+        }
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment = (segment + 1) % NUM_SEGMENTS;
+        segment_offset = 0;
+        waitForSegment(segment);
+    }
+
+    // Times endFrame had to wait for the GPU to finish with a segment
+    int getNumStalls() const
+    {
+        return num_stalls;
+    }
+
+    // Call while the GL context still exists
+    void destroy()
+    {
+        for(int i = 0; i < NUM_SEGMENTS; i++)
+        {
+            if(fences[i])
+            {
+                glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+        }
+        if(buffer)
+        {
+            if(persistent)
+            {
+                g_gl_state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            g_gl_state.deleteBuffer(buffer);
+        }
+        buffer = 0;
+        mapped = nullptr;
+        segment_size = 0;
+        segment_offset = 0;
+    }
+
+private:
+    void waitForSegment(const int i)
+    {
+        if(!fences[i])
+        {
+            return;
+        }
+        GLenum result = glClientWaitSync(fences[i], 0, 0);
+        if(result == GL_TIMEOUT_EXPIRED)
+        {
+            num_stalls++;
+            // Flush so the fence is sure to signal, then wait as long as it takes
+            do
+            {
+                result = glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while(result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fences[i]);
+        fences[i] = 0;
+    }
+
+    // Make every segment hold at least min_segment_size bytes
+    // Starts over in a new buffer, writes made to the old one this frame stay valid
+    void grow(const GLsizeiptr min_segment_size)
+    {
+        GLsizeiptr new_segment_size = segment_size > 0 ? segment_size * 2 : 1 << 20;
+        while(new_segment_size < min_segment_size)
+        {
+            new_segment_size *= 2;
+        }
+        destroy();
+        segment_size = new_segment_size;
+        segment = 0;
+        segment_offset = 0;
+        GLsizeiptr total_size = segment_size * NUM_SEGMENTS;
+        glGenBuffers(1, &buffer);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        persistent = GLEW_ARB_buffer_storage;
+        if(persistent)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, total_size, nullptr, flags);
+            mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total_size, flags);
+            persistent = mapped != nullptr;
+            if(!persistent)
+            {
+                // Storage made with glBufferStorage is immutable, start over for glBufferData
+                g_gl_state.deleteBuffer(buffer);
+                glGenBuffers(1, &buffer);
+                g_gl_state.bindBuffer(GL_ARRAY_BUFFER, buffer);
+            }
+        }
+        if(!persistent)
+        {
+            glBufferData(GL_ARRAY_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    GLuint buffer;
+    char* mapped;
+    bool persistent;
+    GLsizeiptr segment_size;
+    int segment;
+    GLsizeiptr segment_offset;
+    GLsync fences[NUM_SEGMENTS];
+    int num_stalls;
+};
+
+// Defined in main.cpp, shared by all per-frame dynamic geometry
+extern StreamBuffer g_stream_buffer;
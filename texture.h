@@ -1,5 +1,10 @@
 #pragma once
 #include <string>
+#include <cstdio>
+#include <GL/glew.h>
+#include "glstate.h"
+#include "mappedfile.h"
+#include "texturefile.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -39,3 +44,82 @@ public:
     int comp;
     unsigned char *data;
 };
+
+static GLenum getPixelFormat(const int num_channels)
+{
+    const GLenum formats[4] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    return formats[num_channels - 1];
+}
+
+static GLenum getInternalFormat(const int num_channels)
+{
+    const GLenum formats[4] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    return formats[num_channels - 1];
+}
+
+// Uploads every level of a texture cooked by tools/texcook.cpp, returns false if
+// file_name can't be mapped or isn't a valid texture file
+static bool uploadCookedTexture(const char* file_name)
+{
+    MappedFile file;
+    if(!file.open(file_name))
+    {
+        return false;
+    }
+    TextureFileHeader header;
+    const TextureFileLevel* levels = getTextureFileLevels(header, file.getData(), file.getSize());
+    if(!levels)
+    {
+        return false;
+    }
+    GLenum format = getPixelFormat(header.num_channels);
+    GLenum internal_format = getInternalFormat(header.num_channels);
+    // Allocate the whole chain first, then copy the mapped levels straight in
+    if(GLEW_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, header.num_levels, internal_format, header.width, header.height);
+    }else
+    {
+        for(uint32_t i = 0; i < header.num_levels; i++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, internal_format, levels[i].width, levels[i].height, 0, format,
+                         GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.num_levels - 1);
+    // Rows are tightly packed, RGB rows aren't a multiple of 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(uint32_t i = 0; i < header.num_levels; i++)
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levels[i].width, levels[i].height, format, GL_UNSIGNED_BYTE,
+                        file.getData() + levels[i].offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return true;
+}
+
+/*
+  Makes a mipmapped, repeating 2D texture, bound to texture unit 0 afterwards
+  Loads cooked_file_name when it exists. Otherwise image_file_name is decoded and
+  GL generates the mipmaps, which is slower and filters in gamma space.
+ */
+static GLuint loadTexture2D(const char* cooked_file_name, const char* image_file_name)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    g_gl_state.bindTexture2D(0, texture);
+    if(!uploadCookedTexture(cooked_file_name))
+    {
+        fprintf(stderr, "No cooked texture %s, decoding %s\n", cooked_file_name, image_file_name);
+        Texture image(image_file_name);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
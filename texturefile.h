@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+/*
+  Cooked texture file, written by tools/texcook.cpp
+  A TextureFileHeader, then num_levels TextureFileLevels, then the pixels of every
+  mip level from the full size one down to 1x1, each tightly packed rows of 8 bit
+  channels starting at a 4 byte aligned offset. Loading maps the file and hands
+  each level to GL as it is.
+  Bump TEXTURE_FILE_VERSION whenever the header or level layout changes.
+ */
+const char TEXTURE_FILE_MAGIC[4] = {'T', 'E', 'X', 'C'};
+const uint32_t TEXTURE_FILE_VERSION = 1;
+const char* const TEXTURE_FILE_EXTENSION = ".tex";
+// The levels were filtered in linear space from sRGB encoded colors
+const uint32_t TEXTURE_FILE_SRGB = 1;
+
+struct TextureFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_channels;
+    uint32_t num_levels;
+    uint32_t flags;
+};
+
+struct TextureFileLevel
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;    // From the start of the file
+    uint32_t size;
+};
+
+// Returns the level table of the texture file in data, or nullptr if it isn't a valid one
+// data has to be 4 byte aligned, which mmap and malloc'd buffers are
+inline const TextureFileLevel* getTextureFileLevels(TextureFileHeader& header, const char* data, const size_t size)
+{
+    if(size < sizeof(TextureFileHeader) || memcmp(data, TEXTURE_FILE_MAGIC, sizeof(TEXTURE_FILE_MAGIC)) != 0)
+    {
+        return nullptr;
+    }
+    memcpy(&header, data, sizeof(header));
+    if(header.version != TEXTURE_FILE_VERSION)
+    {
+        fprintf(stderr, "Unsupported texture file version %u\n", header.version);
+        return nullptr;
+    }
+    if(header.width == 0 || header.height == 0 || header.num_levels == 0 || header.num_levels > 32 ||
+       header.num_channels == 0 || header.num_channels > 4 ||
+       (size - sizeof(TextureFileHeader)) / sizeof(TextureFileLevel) < header.num_levels)
+    {
+        fprintf(stderr, "Texture file header is corrupt\n");
+        return nullptr;
+    }
+    const TextureFileLevel* levels = (const TextureFileLevel*)(data + sizeof(TextureFileHeader));
+    for(uint32_t i = 0; i < header.num_levels; i++)
+    {
+        const TextureFileLevel& level = levels[i];
+        // GL allocates the chain from the header, so every level has to be the size it expects,
+        // and the chain can't go on past 1x1
+        uint32_t expected_width = header.width >> i > 1 ? header.width >> i : 1;
+        uint32_t expected_height = header.height >> i > 1 ? header.height >> i : 1;
+        if(level.width != expected_width || level.height != expected_height ||
+           (i > 0 && levels[i - 1].width == 1 && levels[i - 1].height == 1))
+        {
+            fprintf(stderr, "Texture file level %u is %ux%u, not %ux%u\n", i, level.width, level.height,
+                    expected_width, expected_height);
+            return nullptr;
+        }
+        uint64_t expected_size = (uint64_t)level.width * level.height * header.num_channels;
+        if(level.size != expected_size || level.offset > size || size - level.offset < level.size)
+        {
+            fprintf(stderr, "Texture file level %u is truncated\n", i);
+            return nullptr;
+        }
+    }
+    return levels;
+}
+
+// levels holds the pixels of each level, largest first
+inline bool writeTextureFile(const char* file_name, const int width, const int height, const int num_channels,
+                             const uint32_t flags, const std::vector<std::vector<unsigned char> >& levels)
+{
+    FILE* file = fopen(file_name, "wb");
+    if(!file)
+    {
+        return false;
+    }
+    TextureFileHeader header;
+    memcpy(header.magic, TEXTURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_FILE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.num_channels = num_channels;
+    header.num_levels = levels.size();
+    header.flags = flags;
+
+    std::vector<TextureFileLevel> level_table(levels.size());
+    uint32_t offset = sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * levels.size();
+    int level_width = width, level_height = height;
+    for(int i = 0; i < levels.size(); i++)
+    {
+        level_table[i].width = level_width;
+        level_table[i].height = level_height;
+        level_table[i].offset = offset;
+        level_table[i].size = levels[i].size();
+        offset += (levels[i].size() + 3) & ~3u;
+        level_width = level_width > 1 ? level_width / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(&(level_table[0]), sizeof(TextureFileLevel), level_table.size(), file) == level_table.size();
+    const char padding[4] = {0, 0, 0, 0};
+    for(int i = 0; ok && i < levels.size(); i++)
+    {
+        size_t level_size = levels[i].size();
+        ok = fwrite(&(levels[i][0]), 1, level_size, file) == level_size &&
+             fwrite(padding, 1, ((level_size + 3) & ~3u) - level_size, file) == ((level_size + 3) & ~3u) - level_size;
+    }
+    fclose(file);
+    return ok;
+}
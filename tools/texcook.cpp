@@ -0,0 +1,127 @@
+/*
+  Texture cooker
+  Decodes an image and writes it with its full mip chain in the format of
+  texturefile.h, so the game maps the file and uploads it instead of decoding a PNG
+  and leaving GL without mipmaps.
+  Each level is a 2x2 box filter of the one above. Colors are sRGB encoded, so they
+  are averaged in linear light and encoded again, otherwise every level gets darker.
+  Pass --linear for data like normal maps, which are averaged as they are.
+  Build with "make texcook", then e.g.
+  "./texcook models/Ship2_diffuse.png models/Ship2_diffuse.tex".
+ */
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include "../texturefile.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../stb_image.h"
+
+// Same channels as the PNG fallback in texture.h loads
+const int NUM_CHANNELS = 3;
+
+static float srgbToLinear(const float c)
+{
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(const float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+static unsigned char toByte(const float c)
+{
+    float scaled = c * 255.0f + 0.5f;
+    return scaled <= 0.0f ? 0 : scaled >= 255.0f ? 255 : (unsigned char)scaled;
+}
+
+// Halves src, an odd last row or column is averaged with itself
+static void downsample(std::vector<unsigned char>& dst, const std::vector<unsigned char>& src, const int width,
+                       const int height, const bool srgb, const float* to_linear)
+{
+    int dst_width = width > 1 ? width / 2 : 1;
+    int dst_height = height > 1 ? height / 2 : 1;
+    dst.resize(dst_width * dst_height * NUM_CHANNELS);
+    for(int y = 0; y < dst_height; y++)
+    {
+        int y0 = 2 * y, y1 = 2 * y + 1 < height ? 2 * y + 1 : height - 1;
+        for(int x = 0; x < dst_width; x++)
+        {
+            int x0 = 2 * x, x1 = 2 * x + 1 < width ? 2 * x + 1 : width - 1;
+            const unsigned char* samples[4] = {&(src[(y0 * width + x0) * NUM_CHANNELS]),
+                                               &(src[(y0 * width + x1) * NUM_CHANNELS]),
+                                               &(src[(y1 * width + x0) * NUM_CHANNELS]),
+                                               &(src[(y1 * width + x1) * NUM_CHANNELS])};
+            for(int c = 0; c < NUM_CHANNELS; c++)
+            {
+                float sum = 0.0f;
+                for(int i = 0; i < 4; i++)
+                {
+                    sum += srgb ? to_linear[samples[i][c]] : samples[i][c] / 255.0f;
+                }
+                float average = sum * 0.25f;
+                dst[(y * dst_width + x) * NUM_CHANNELS + c] = toByte(srgb ? linearToSrgb(average) : average);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool srgb = true;
+    int arg = 1;
+    if(arg < argc && strcmp(argv[arg], "--linear") == 0)
+    {
+        srgb = false;
+        arg++;
+    }
+    if(argc - arg != 2)
+    {
+        fprintf(stderr, "Usage: %s [--linear] input_image output%s\n", argv[0], TEXTURE_FILE_EXTENSION);
+        fprintf(stderr, "--linear filters the channels as they are instead of as sRGB colors\n");
+        return 1;
+    }
+    const char* input_file_name = argv[arg];
+    const char* output_file_name = argv[arg + 1];
+
+    int width, height, comp;
+    unsigned char* pixels = stbi_load(input_file_name, &width, &height, &comp, NUM_CHANNELS);
+    if(!pixels)
+    {
+        fprintf(stderr, "Can't decode %s: %s\n", input_file_name, stbi_failure_reason());
+        return 1;
+    }
+    float to_linear[256];
+    for(int i = 0; i < 256; i++)
+    {
+        to_linear[i] = srgbToLinear(i / 255.0f);
+    }
+
+    std::vector<std::vector<unsigned char> > levels(1);
+    levels[0].assign(pixels, pixels + width * height * NUM_CHANNELS);
+    stbi_image_free(pixels);
+    int level_width = width, level_height = height;
+    while(level_width > 1 || level_height > 1)
+    {
+        levels.push_back(std::vector<unsigned char>());
+        downsample(levels.back(), levels[levels.size() - 2], level_width, level_height, srgb, to_linear);
+        level_width = level_width > 1 ? level_width / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+    }
+
+    if(!writeTextureFile(output_file_name, width, height, NUM_CHANNELS, srgb ? TEXTURE_FILE_SRGB : 0, levels))
+    {
+        fprintf(stderr, "Can't write %s\n", output_file_name);
+        return 1;
+    }
+    size_t total_size = 0;
+    for(int i = 0; i < levels.size(); i++)
+    {
+        total_size += levels[i].size();
+    }
+    printf("Wrote %dx%d, %d levels, %zu bytes to %s\n", width, height, (int)levels.size(), total_size,
+           output_file_name);
+    return 0;
+}
@@ -0,0 +1,28 @@
+/*
+  Track file converter
+  Converts between the text track format and the binary one in trackfile.h.
+  The output format follows the output file name, see Track::writeToFile.
+  Build with "make trackconvert", then e.g. "./trackconvert track1.txt track1.trk".
+ */
+#include <cstdio>
+#include "../track.h"
+
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        fprintf(stderr, "Usage: %s input_track output_track\n", argv[0]);
+        fprintf(stderr, "Output names ending in %s are written as binary, others as text\n", TRACK_FILE_EXTENSION);
+        return 1;
+    }
+    Track track;
+    track.readFromFile(argv[1]);
+    if(track.getNumBoxes() == 0)
+    {
+        fprintf(stderr, "No boxes read from %s\n", argv[1]);
+        return 1;
+    }
+    track.writeToFile(argv[2]);
+    printf("Wrote %d boxes to %s\n", track.getNumBoxes(), argv[2]);
+    return 0;
+}
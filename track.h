@@ -1,75 +1,118 @@
 #pragma once
 #include "box.h"
 #include "ray.h"
+#include "spatialgrid.h"
+#include "bvh.h"
+#include "boxstore.h"
+#include "trackfile.h"
+#include "mappedfile.h"
 #include <vector>
 #include "vec.h"
 #include <iostream>
+#include <fstream>
+
+// Below this many boxes a SIMD scan of the BoxStore beats the grid lookups
+const int BRUTE_FORCE_MAX_BOXES = 512;
 
 class Track
 {
 public:
     Track()
+        :collision_grid_dirty(false), collision_store_dirty(false), pick_bvh_dirty(false), revision(0),
+        all_boxes_changed(true)
     {
-        shader_program = loadAndLinkShaders("shaders/box.vs", "shaders/box.fs");
-    }
-
-    // TODO: the name impliles all the uniforms are set
-    void setUniforms(const Mat4& view_transform, const Mat4& normal_transform,
-                     const Mat4& proj_transform, const Vec3& dir_light)
-    {
-        glUseProgram(shader_program);
-        GLint view_handle = glGetUniformLocation(shader_program, "view_mat");
-        glUniformMatrix4fv(view_handle, 1, GL_TRUE, &(view_transform.data[0][0]));
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-        GLint normal_transform_handle = glGetUniformLocation(shader_program, "normal_mat");
-        glUniformMatrix4fv(normal_transform_handle, 1, GL_TRUE, &(normal_transform.data[0][0]));
-    
-        GLint dir_light_handle = glGetUniformLocation(shader_program, "dir_light");
-        glUniform3fv(dir_light_handle, 1, (const GLfloat*)(dir_light.data));
-        glUseProgram(0);
     }
 
-    int addBox(Box& box)
+    int addBox(const Box& box)
     {
-        box.setShaderAndAttributes(shader_program);
         boxes.push_back(box);
+        int index = boxes.size() - 1;
+        markBoxChanged(index);
+        if(!collision_grid_dirty)
+        {
+            collision_grid.insert(index, boxes[index]);
+        }
+        if(!collision_store_dirty)
+        {
+            collision_store.push(boxes[index]);
+        }
+        // Many adds in a row, like building a track in code, get one fresh build instead
+        if(pick_bvh.needsRebuild())
+        {
+            pick_bvh_dirty = true;
+        }
+        if(!pick_bvh_dirty)
+        {
+            pick_bvh.insert(index, boxes[index]);
+        }
         //return &(boxes[boxes.size() - 1]);
-        return boxes.size() - 1;
+        return index;
     }
 
     bool removeBox(const Box* box_ptr)
     {
-        bool found_box = false;
-        int i;
-        for(i = 0; i < boxes.size(); i++)
+        for(int i = 0; i < boxes.size(); i++)
         {
             if(&(boxes[i]) == box_ptr)
             {
-                found_box = true;
-                break;
+                return removeBox(i);
             }
         }
-        if(found_box)
-        {
-            boxes[i].deleteBox();
-            boxes.erase(boxes.begin()+i);
-            return true;
-        }
         return false;
     }
 
+    // The last box is moved into index, so only the last index changes
     bool removeBox(const int index)
     {
         if(index > -1 && boxes.size() > index)
         {
-            boxes.erase(boxes.begin() + index);
+            int last = boxes.size() - 1;
+            markBoxChanged(index);
+            if(!collision_grid_dirty)
+            {
+                collision_grid.remove(index);
+                if(index != last)
+                {
+                    collision_grid.remove(last);
+                    collision_grid.insert(index, boxes[last]);
+                }
+            }
+            if(!collision_store_dirty)
+            {
+                collision_store.swapRemove(index);
+            }
+            if(!pick_bvh_dirty)
+            {
+                pick_bvh.remove(index);
+                pick_bvh.relabel(last, index);
+            }
+            boxes[index] = boxes[last];
+            boxes.pop_back();
             return true;
         }
         return false;
     }
 
-    int getNumBoxes()
+    // Call after changing the bounds of the box at index
+    void refitBox(const int index)
+    {
+        markBoxChanged(index);
+        if(!collision_grid_dirty)
+        {
+            collision_grid.remove(index);
+            collision_grid.insert(index, boxes[index]);
+        }
+        if(!collision_store_dirty)
+        {
+            collision_store.set(index, boxes[index]);
+        }
+        if(!pick_bvh_dirty)
+        {
+            pick_bvh.update(index, boxes[index]);
+        }
+    }
+
+    int getNumBoxes() const
     {
         return boxes.size();
     }
@@ -79,31 +122,62 @@ public:
         return boxes[index];
     }
 
+    const Box& getBoxAtIndex(const int index) const
+    {
+        return boxes[index];
+    }
+
+    void setBoxColor(const int index, const Vec3& color)
+    {
+        boxes[index].setColor(color);
+        markBoxChanged(index);
+    }
+
+    // Changes every time a box is added, removed or changed, so renderers know when to upload
+    int getRevision() const
+    {
+        return revision;
+    }
+
+    // Indices of the boxes changed since the last clearChanges, for TrackRenderer's
+    // sub-range uploads. An index may be listed more than once, and removing a box
+    // lists the slot the last box moved into.
+    const std::vector<int>& getChangedBoxes() const
+    {
+        return changed_boxes;
+    }
+
+    // True when too much changed to list, everything has to be uploaded again
+    bool allBoxesChanged() const
+    {
+        return all_boxes_changed;
+    }
+
+    void clearChanges()
+    {
+        changed_boxes.clear();
+        all_boxes_changed = false;
+    }
+
     //Box* rayIntersectTrack(int& face, float& t, const Ray& ray)
     int rayIntersectTrack(int& face, float& t, const Ray& ray)
     {
-        float min_t = TMAX;
-        int index = -1, min_face = -1;
-        for(int i = 0; i < boxes.size(); i++)
-        {
-            int side;
-            float t = boxes[i].rayIntersect(side, ray);
-            if(t < min_t)
-            {
-                min_t = t;
-                index = i;
-                min_face = side;
-            }
-        }
-        face = min_face;
-        t = min_t;
-        if(index != -1)
-        {
-            //return &(boxes[index]);
-            return index;
-        }
-        //return nullptr;
-        return -1;
+        return rayIntersectTrack(face, t, ray, [](const int){ return true; });
+    }
+
+    // Only boxes whose index passes accept(index) can be hit
+    template <typename Filter>
+    int rayIntersectTrack(int& face, float& t, const Ray& ray, Filter accept)
+    {
+        updatePickBVH();
+        return pick_bvh.rayIntersect(face, t, ray, accept);
+    }
+
+    // Append the indices of the boxes at least partly inside frustum to box_indices
+    void frustumQueryTrack(std::vector<int>& box_indices, const Frustum& frustum)
+    {
+        updatePickBVH();
+        pick_bvh.frustumQuery(box_indices, frustum);
     }
 
     // Determine if ship bbox collide with track
@@ -112,44 +186,42 @@ public:
     // 4 * 6 sides = 24
     int bboxCollideWithTrack(Box* colliding_boxes[24], const BBox& bbox)
     {
-        int count = 0;
-        Vec3 center_dir(0.0f, 0.0f, 0.0f);
-
-        Vec3 ship_center = (bbox.max - bbox.min) * 0.5f + bbox.min;
-        for(int i = 0; i < boxes.size(); i++)
+        int box_indices[24];
+        int count = bboxQueryTrack(box_indices, 24, bbox);
+        for(int i = 0; i < count; i++)
         {
-            if(bbox.bboxIntersect(boxes[i]))
-            {
-
-                colliding_boxes[count] = &(boxes[i]);
-                count++;
-            }
+            colliding_boxes[i] = &(boxes[box_indices[i]]);
         }
         return count;
     }
 
-    void setViewTransform(const Mat4& view_transform)
+    // Write the indices of the boxes that intersect bbox into box_indices
+    // Returns the number written, at most max_boxes
+    int bboxQueryTrack(int* box_indices, const int max_boxes, const BBox& bbox)
     {
-        glUseProgram(shader_program);
-        GLint view_handle = glGetUniformLocation(shader_program, "view_mat");
-        glUniformMatrix4fv(view_handle, 1, GL_TRUE, &(view_transform.data[0][0]));
-        glUseProgram(0);
+        if(boxes.size() <= BRUTE_FORCE_MAX_BOXES)
+        {
+            if(collision_store_dirty)
+            {
+                rebuildCollisionStore();
+            }
+            return collision_store.overlapQuery(box_indices, max_boxes, bbox);
+        }
+        if(collision_grid_dirty)
+        {
+            rebuildCollisionGrid();
+        }
+        return collision_grid.query(box_indices, max_boxes, bbox);
     }
 
-    void setProjTransform(const Mat4& proj_transform)
-    {
-        glUseProgram(shader_program);
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-        glUseProgram(0);
-    }    
-
-    void draw()
+    // Call after changing many boxes at once, refitBox is cheaper for a few
+    // The collision grid, box store and picking BVH get rebuilt on their next query
+    void invalidateSpatialIndexes()
     {
-        for(int i = 0; i < boxes.size(); i++)
-        {
-            boxes[i].draw();
-        }
+        collision_grid_dirty = true;
+        collision_store_dirty = true;
+        pick_bvh_dirty = true;
+        markAllBoxesChanged();
     }
 
     void print()
@@ -162,8 +234,25 @@ public:
         }
     }
 
+    // Reads binary track files (see trackfile.h) and the old text format of
+    // six floats per box
     void readFromFile(const char* file_name)
     {
+        // A fresh build gives better trees than inserting boxes one by one
+        invalidateSpatialIndexes();
+        {
+            MappedFile file;
+            if(file.open(file_name) && isTrackFile(file.getData(), file.getSize()))
+            {
+                int num_boxes;
+                const TrackFileRecord* records = getTrackFileRecords(num_boxes, file.getData(), file.getSize());
+                if(records)
+                {
+                    addBoxes(records, num_boxes);
+                }
+                return;
+            }
+        }
         std::ifstream input(file_name);
         float tmp;
         int i = 0;
@@ -188,8 +277,19 @@ public:
         input.close();
     }
 
+    // Writes a binary track file if file_name ends with TRACK_FILE_EXTENSION, text otherwise
     void writeToFile(const char* file_name)
     {
+        size_t name_len = strlen(file_name);
+        size_t ext_len = strlen(TRACK_FILE_EXTENSION);
+        if(name_len >= ext_len && strcmp(file_name + name_len - ext_len, TRACK_FILE_EXTENSION) == 0)
+        {
+            if(!writeTrackFile(file_name, boxes))
+            {
+                std::cerr << "Failed to write " << file_name << "\n";
+            }
+            return;
+        }
         std::ofstream output(file_name);
         for(int i = 0; i < boxes.size(); i++)
         {
@@ -203,24 +303,95 @@ public:
         output.close();
     }
 
-    ~Track()
+    void deleteBoxes()
+    {
+        boxes.clear();
+        markAllBoxesChanged();
+        collision_grid.clear();
+        collision_grid_dirty = false;
+        collision_store.clear();
+        collision_store_dirty = false;
+        pick_bvh.clear();
+        pick_bvh_dirty = false;
+    }
+private:
+    // Boxes in track files are already snapped, so they are copied as they are
+    void addBoxes(const TrackFileRecord* records, const int num_boxes)
     {
-        glDeleteProgram(shader_program);
+        boxes.reserve(boxes.size() + num_boxes);
+        for(int i = 0; i < num_boxes; i++)
+        {
+            Box box;
+            box.min = Vec3(records[i].min[0], records[i].min[1], records[i].min[2]);
+            box.max = Vec3(records[i].max[0], records[i].max[1], records[i].max[2]);
+            box.setColor(Vec3(records[i].color[0], records[i].color[1], records[i].color[2]));
+            boxes.push_back(box);
+        }
+        invalidateSpatialIndexes();
+    }
+
+    void markBoxChanged(const int index)
+    {
+        revision++;
+        if(all_boxes_changed)
+        {
+            return;
+        }
+        // Past this many it is cheaper to upload everything once
+        if(changed_boxes.size() >= boxes.size() / 2 + 16)
+        {
+            markAllBoxesChanged();
+            return;
+        }
+        changed_boxes.push_back(index);
+    }
+
+    void markAllBoxesChanged()
+    {
+        revision++;
+        all_boxes_changed = true;
+        changed_boxes.clear();
+    }
+
+    void updatePickBVH()
+    {
+        if(pick_bvh_dirty || pick_bvh.needsRebuild())
+        {
+            pick_bvh.build(boxes);
+            pick_bvh_dirty = false;
+        }
+    }
+
+    void rebuildCollisionGrid()
+    {
+        collision_grid.clear();
         for(int i = 0; i < boxes.size(); i++)
         {
-            boxes[i].deleteBox();
+            collision_grid.insert(i, boxes[i]);
         }
+        collision_grid_dirty = false;
     }
 
-    void deleteBoxes()
+    void rebuildCollisionStore()
     {
+        collision_store.clear();
+        collision_store.reserve(boxes.size());
         for(int i = 0; i < boxes.size(); i++)
         {
-            boxes[i].deleteBox();
+            collision_store.push(boxes[i]);
         }
-        boxes.clear();
+        collision_store_dirty = false;
     }
-private:
+
     std::vector<Box> boxes;
-    GLuint shader_program;    
+    SpatialGrid collision_grid;
+    bool collision_grid_dirty;
+    BoxStore collision_store;
+    bool collision_store_dirty;
+    // Used for view frustum culling as well as picking
+    BVH pick_bvh;
+    bool pick_bvh_dirty;
+    int revision;
+    std::vector<int> changed_boxes;
+    bool all_boxes_changed;
 };
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include "box.h"
+
+/*
+  Binary track file
+  A TrackFileHeader followed by num_boxes TrackFileRecords, little endian floats
+  and integers. Records are written exactly as they are loaded, so loading is a
+  bounds check and a copy.
+  Bump TRACK_FILE_VERSION whenever the header or record layout changes.
+ */
+const char TRACK_FILE_MAGIC[4] = {'T', 'R', 'A', 'K'};
+const uint32_t TRACK_FILE_VERSION = 1;
+// Track::writeToFile writes this format for file names ending with it
+const char* const TRACK_FILE_EXTENSION = ".trk";
+
+struct TrackFileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t num_boxes;
+    uint32_t record_size;   // sizeof(TrackFileRecord), so readers can reject other layouts
+};
+
+struct TrackFileRecord
+{
+    float min[3];
+    float max[3];
+    float color[3];
+};
+
+static bool isTrackFile(const char* data, const size_t size)
+{
+    return size >= sizeof(TrackFileHeader) && memcmp(data, TRACK_FILE_MAGIC, sizeof(TRACK_FILE_MAGIC)) == 0;
+}
+
+// Returns the records of the track file in data, or nullptr if it isn't a valid one
+// data has to be 4 byte aligned, which mmap and malloc'd buffers are
+static const TrackFileRecord* getTrackFileRecords(int& num_boxes, const char* data, const size_t size)
+{
+    num_boxes = 0;
+    if(!isTrackFile(data, size))
+    {
+        return nullptr;
+    }
+    TrackFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if(header.version != TRACK_FILE_VERSION || header.record_size != sizeof(TrackFileRecord))
+    {
+        fprintf(stderr, "Unsupported track file version %u\n", header.version);
+        return nullptr;
+    }
+    if((size - sizeof(TrackFileHeader)) / sizeof(TrackFileRecord) < header.num_boxes)
+    {
+        fprintf(stderr, "Track file is truncated\n");
+        return nullptr;
+    }
+    num_boxes = header.num_boxes;
+    return (const TrackFileRecord*)(data + sizeof(TrackFileHeader));
+}
+
+static bool writeTrackFile(const char* file_name, const std::vector<Box>& boxes)
+{
+    FILE* file = fopen(file_name, "wb");
+    if(!file)
+    {
+        return false;
+    }
+    TrackFileHeader header;
+    memcpy(header.magic, TRACK_FILE_MAGIC, sizeof(header.magic));
+    header.version = TRACK_FILE_VERSION;
+    header.num_boxes = boxes.size();
+    header.record_size = sizeof(TrackFileRecord);
+    std::vector<TrackFileRecord> records(boxes.size());
+    for(int i = 0; i < boxes.size(); i++)
+    {
+        Vec3 color = boxes[i].getColor();
+        for(int j = 0; j < 3; j++)
+        {
+            records[i].min[j] = boxes[i].min[j];
+            records[i].max[j] = boxes[i].max[j];
+            records[i].color[j] = color[j];
+        }
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if(ok && !records.empty())
+    {
+        ok = fwrite(&(records[0]), sizeof(TrackFileRecord), records.size(), file) == records.size();
+    }
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,616 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <stdint.h>
+#include <math.h>
+#include <GL/glew.h>
+#include "vec.h"
+#include "bbox.h"
+#include "frustum.h"
+#include "track.h"
+#include "glstate.h"
+#include "renderqueue.h"
+#include "shaders/shaderregistry.h"
+
+struct TrackMeshStats
+{
+    int num_boxes;
+    int box_triangles;
+    int mesh_triangles;
+    int num_chunks;
+};
+
+// A run of indices covering one chunk of the track, and the bounds of its vertices
+struct TrackMeshChunk
+{
+    BBox bounds;
+    int first_index;
+    int num_indices;
+};
+
+/*
+  Compiles a Track into one indexed triangle mesh with greedy meshing
+  Box corners lie on the GRID_UNIT grid, so every face lies in a grid plane and
+  covers whole cells of it. For each axis the planes are swept in order, keeping
+  the boxes that span the current plane. On each plane and side, the cells covered
+  by faces are rasterized into a 2D mask with the face's color, cells behind a
+  touching or overlapping box are cleared, and what is left is merged greedily into
+  rectangles of one color, two triangles each.
+  Each plane is rasterized one CHUNK_CELLS square tile at a time, only where there
+  are faces and at most the size of a tile, so rectangles never cross the borders of
+  CHUNK_CELLS sized cubes of cells.
+  The indices are grouped by cube into chunks so they can be culled separately.
+  Vertices are position, normal and color, 9 floats. Needs no GL context.
+ */
+class TrackMesher
+{
+public:
+    static const int FLOATS_PER_VERTEX = 9;
+    static const int CHUNK_CELLS = 32;
+
+    void build(const Track& track, std::vector<float>& vertices, std::vector<unsigned int>& indices,
+               std::vector<TrackMeshChunk>& chunks)
+    {
+        vertices.clear();
+        indices.clear();
+        chunks.clear();
+        colors.clear();
+        cells.clear();
+        quads.clear();
+        int num_boxes = track.getNumBoxes();
+        for(int i = 0; i < num_boxes; i++)
+        {
+            const Box& box = track.getBoxAtIndex(i);
+            BoxCells c;
+            bool empty = false;
+            for(int j = 0; j < 3; j++)
+            {
+                c.lo[j] = toCell(box.min[j]);
+                c.hi[j] = toCell(box.max[j]);
+                empty = empty || c.hi[j] <= c.lo[j];
+            }
+            // A flat box has no inside to bound, and would hide its own faces
+            if(empty)
+            {
+                continue;
+            }
+            c.color_id = findColor(box.getColor());
+            cells.push_back(c);
+        }
+        for(int axis = 0; axis < 3; axis++)
+        {
+            sweepAxis(axis, vertices);
+        }
+        buildChunks(vertices, indices, chunks);
+        stats.num_boxes = num_boxes;
+        stats.box_triangles = num_boxes * 12;
+        stats.mesh_triangles = indices.size() / 3;
+        stats.num_chunks = chunks.size();
+    }
+
+    TrackMeshStats getStats() const
+    {
+        return stats;
+    }
+
+    void printStats() const
+    {
+        printf("Track mesh: %d boxes, %d triangles as boxes, %d merged (%.1f%% fewer) in %d chunks\n",
+               stats.num_boxes, stats.box_triangles, stats.mesh_triangles,
+               stats.box_triangles > 0 ? 100.0f * (stats.box_triangles - stats.mesh_triangles) / stats.box_triangles
+                                       : 0.0f,
+               stats.num_chunks);
+    }
+
+private:
+    struct BoxCells
+    {
+        int lo[3];
+        int hi[3];
+        int color_id;
+    };
+
+    struct ChunkQuad
+    {
+        uint64_t chunk_key;
+        unsigned int first_vertex;
+
+        bool operator<(const ChunkQuad& other) const
+        {
+            return chunk_key < other.chunk_key ||
+                   (chunk_key == other.chunk_key && first_vertex < other.first_vertex);
+        }
+    };
+
+    // A box's part of one tile of a plane, sorted by tile, faces first, then by box
+    // so the last of coincident faces to paint the mask is always the same one
+    struct TileBox
+    {
+        uint64_t tile_key;
+        int box;
+        bool hider;
+
+        bool operator<(const TileBox& other) const
+        {
+            if(tile_key != other.tile_key)
+            {
+                return tile_key < other.tile_key;
+            }
+            if(hider != other.hider)
+            {
+                return !hider;
+            }
+            return box < other.box;
+        }
+    };
+
+    static int toCell(const float f)
+    {
+        return (int)floorf(f / GRID_UNIT + 0.5f);
+    }
+
+    // Rounds towards negative infinity, so cells -CHUNK_CELLS..-1 are chunk -1
+    static int toChunk(const int cell)
+    {
+        return cell >= 0 ? cell / CHUNK_CELLS : (cell + 1) / CHUNK_CELLS - 1;
+    }
+
+    static const int TILE_BIAS = 1 << 30;
+
+    // Orders tiles by u then v, so the tiles of one u are a contiguous range
+    static uint64_t packTileKey(const int tile_u, const int tile_v)
+    {
+        return ((uint64_t)(uint32_t)(tile_u + TILE_BIAS) << 32) | (uint32_t)(tile_v + TILE_BIAS);
+    }
+
+    // 21 bits per axis, enough for tracks two million cells across
+    static uint64_t packChunkKey(const int chunk[3])
+    {
+        const int bias = 1 << 20;
+        return ((uint64_t)(chunk[0] + bias) << 42) | ((uint64_t)(chunk[1] + bias) << 21) | (uint64_t)(chunk[2] + bias);
+    }
+
+    int findColor(const Vec3& color)
+    {
+        for(int i = 0; i < colors.size(); i++)
+        {
+            if(colors[i][0] == color[0] && colors[i][1] == color[1] && colors[i][2] == color[2])
+            {
+                return i;
+            }
+        }
+        colors.push_back(color);
+        return colors.size() - 1;
+    }
+
+    void sweepAxis(const int axis, std::vector<float>& vertices)
+    {
+        by_lo.clear();
+        by_hi.clear();
+        planes.clear();
+        for(int i = 0; i < cells.size(); i++)
+        {
+            by_lo.push_back(i);
+            by_hi.push_back(i);
+            planes.push_back(cells[i].lo[axis]);
+            planes.push_back(cells[i].hi[axis]);
+        }
+        std::sort(by_lo.begin(), by_lo.end(), CompareLo(cells, axis));
+        std::sort(by_hi.begin(), by_hi.end(), CompareHi(cells, axis));
+        std::sort(planes.begin(), planes.end());
+        planes.erase(std::unique(planes.begin(), planes.end()), planes.end());
+
+        active.clear();
+        int next_lo = 0, next_hi = 0;
+        for(int p = 0; p < planes.size(); p++)
+        {
+            int k = planes[p];
+            // Boxes that started before k, and among them drop the ones that ended by k
+            while(next_lo < by_lo.size() && cells[by_lo[next_lo]].lo[axis] < k)
+            {
+                active.push_back(by_lo[next_lo]);
+                next_lo++;
+            }
+            for(int i = 0; i < active.size();)
+            {
+                if(cells[active[i]].hi[axis] <= k)
+                {
+                    active[i] = active.back();
+                    active.pop_back();
+                }else
+                {
+                    i++;
+                }
+            }
+            // Boxes starting and ending at k
+            starting.clear();
+            for(int i = next_lo; i < by_lo.size() && cells[by_lo[i]].lo[axis] == k; i++)
+            {
+                starting.push_back(by_lo[i]);
+            }
+            while(next_hi < by_hi.size() && cells[by_hi[next_hi]].hi[axis] < k)
+            {
+                next_hi++;
+            }
+            ending.clear();
+            for(int i = next_hi; i < by_hi.size() && cells[by_hi[i]].hi[axis] == k; i++)
+            {
+                ending.push_back(by_hi[i]);
+            }
+            // Faces towards +axis end at k and are hidden by what starts there, and the reverse
+            meshPlane(axis, k, true, ending, starting, vertices);
+            meshPlane(axis, k, false, starting, ending, vertices);
+        }
+    }
+
+    // Splits the plane into CHUNK_CELLS square tiles and meshes each tile that has faces
+    // on its own, so the work follows the boxes rather than the area between them
+    void meshPlane(const int axis, const int k, const bool positive, const std::vector<int>& faces,
+                   const std::vector<int>& hiders, std::vector<float>& vertices)
+    {
+        if(faces.empty())
+        {
+            return;
+        }
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        tile_boxes.clear();
+        for(int i = 0; i < faces.size(); i++)
+        {
+            addToTiles(faces[i], false, u, v);
+        }
+        std::sort(tile_boxes.begin(), tile_boxes.end());
+        tiles.clear();
+        for(int i = 0; i < tile_boxes.size(); i++)
+        {
+            if(tiles.empty() || tiles.back() != tile_boxes[i].tile_key)
+            {
+                tiles.push_back(tile_boxes[i].tile_key);
+            }
+        }
+        // Hiders and spanning boxes only matter on tiles that have faces
+        for(int i = 0; i < hiders.size(); i++)
+        {
+            addToTiles(hiders[i], true, u, v);
+        }
+        for(int i = 0; i < active.size(); i++)
+        {
+            addToTiles(active[i], true, u, v);
+        }
+        // Faces sort before hiders within a tile
+        std::sort(tile_boxes.begin(), tile_boxes.end());
+
+        for(int first = 0; first < tile_boxes.size();)
+        {
+            uint64_t tile_key = tile_boxes[first].tile_key;
+            int tile_u = (int)(tile_key >> 32) - TILE_BIAS, tile_v = (int)(tile_key & 0xffffffffu) - TILE_BIAS;
+            int last = first;
+            while(last < tile_boxes.size() && tile_boxes[last].tile_key == tile_key)
+            {
+                last++;
+            }
+            // The mask only needs to cover the faces' part of the tile
+            int tile_u_min = tile_u * CHUNK_CELLS, tile_v_min = tile_v * CHUNK_CELLS;
+            int u_min = tile_u_min + CHUNK_CELLS, u_max = tile_u_min;
+            int v_min = tile_v_min + CHUNK_CELLS, v_max = tile_v_min;
+            for(int i = first; i < last && !tile_boxes[i].hider; i++)
+            {
+                const BoxCells& c = cells[tile_boxes[i].box];
+                u_min = std::min(u_min, std::max(c.lo[u], tile_u_min));
+                u_max = std::max(u_max, std::min(c.hi[u], tile_u_min + CHUNK_CELLS));
+                v_min = std::min(v_min, std::max(c.lo[v], tile_v_min));
+                v_max = std::max(v_max, std::min(c.hi[v], tile_v_min + CHUNK_CELLS));
+            }
+            int width = u_max - u_min, height = v_max - v_min;
+            mask.assign(width * height, 0);
+            for(int i = first; i < last; i++)
+            {
+                const BoxCells& c = cells[tile_boxes[i].box];
+                fillMask(c, u, v, u_min, v_min, width, height, tile_boxes[i].hider ? 0 : c.color_id + 1);
+            }
+            mergeMask(axis, k, positive, u_min, v_min, width, height, vertices);
+            first = last;
+        }
+    }
+
+    // Adds box to every tile of the plane it covers, hiders only to the tiles in tiles
+    void addToTiles(const int box, const bool hider, const int u, const int v)
+    {
+        const BoxCells& c = cells[box];
+        int tile_u0 = toChunk(c.lo[u]), tile_u1 = toChunk(c.hi[u] - 1);
+        int tile_v0 = toChunk(c.lo[v]), tile_v1 = toChunk(c.hi[v] - 1);
+        TileBox tile_box;
+        tile_box.box = box;
+        tile_box.hider = hider;
+        for(int tile_u = tile_u0; tile_u <= tile_u1; tile_u++)
+        {
+            if(!hider)
+            {
+                for(int tile_v = tile_v0; tile_v <= tile_v1; tile_v++)
+                {
+                    tile_box.tile_key = packTileKey(tile_u, tile_v);
+                    tile_boxes.push_back(tile_box);
+                }
+                continue;
+            }
+            uint64_t last_key = packTileKey(tile_u, tile_v1);
+            for(std::vector<uint64_t>::const_iterator tile = std::lower_bound(tiles.begin(), tiles.end(),
+                                                                              packTileKey(tile_u, tile_v0));
+                tile != tiles.end() && *tile <= last_key; ++tile)
+            {
+                tile_box.tile_key = *tile;
+                tile_boxes.push_back(tile_box);
+            }
+        }
+    }
+
+    // Merges the mask, which starts at cell u_min, v_min, greedily into rectangles of one color
+    void mergeMask(const int axis, const int k, const bool positive, const int u_min, const int v_min,
+                   const int width, const int height, std::vector<float>& vertices)
+    {
+        for(int y = 0; y < height; y++)
+        {
+            for(int x = 0; x < width;)
+            {
+                int id = mask[y * width + x];
+                if(!id)
+                {
+                    x++;
+                    continue;
+                }
+                int quad_width = 1;
+                while(x + quad_width < width && mask[y * width + x + quad_width] == id)
+                {
+                    quad_width++;
+                }
+                int quad_height = 1;
+                while(y + quad_height < height && rowMatches(id, y + quad_height, x, quad_width, width))
+                {
+                    quad_height++;
+                }
+                for(int j = 0; j < quad_height; j++)
+                {
+                    std::fill(mask.begin() + (y + j) * width + x, mask.begin() + (y + j) * width + x + quad_width, 0);
+                }
+                appendQuad(axis, k, positive, u_min + x, v_min + y, quad_width, quad_height, colors[id - 1],
+                           vertices);
+                x += quad_width;
+            }
+        }
+    }
+
+    bool rowMatches(const int id, const int y, const int x, const int quad_width, const int width) const
+    {
+        for(int i = 0; i < quad_width; i++)
+        {
+            if(mask[y * width + x + i] != id)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Sets the cells of the mask that box c covers, clipped to the mask
+    void fillMask(const BoxCells& c, const int u, const int v, const int u_min, const int v_min, const int width,
+                  const int height, const int value)
+    {
+        int x0 = std::max(c.lo[u] - u_min, 0), x1 = std::min(c.hi[u] - u_min, width);
+        int y0 = std::max(c.lo[v] - v_min, 0), y1 = std::min(c.hi[v] - v_min, height);
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = x0; x < x1; x++)
+            {
+                mask[y * width + x] = value;
+            }
+        }
+    }
+
+    // Counter clockwise seen from the side the normal points to
+    // The quad belongs to the chunk of the box whose face it is
+    void appendQuad(const int axis, const int k, const bool positive, const int u0, const int v0,
+                    const int quad_width, const int quad_height, const Vec3& color, std::vector<float>& vertices)
+    {
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        const int corners[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+        int chunk[3];
+        chunk[axis] = toChunk(positive ? k - 1 : k);
+        chunk[u] = toChunk(u0);
+        chunk[v] = toChunk(v0);
+        ChunkQuad quad;
+        quad.chunk_key = packChunkKey(chunk);
+        quad.first_vertex = vertices.size() / FLOATS_PER_VERTEX;
+        quads.push_back(quad);
+        for(int i = 0; i < 4; i++)
+        {
+            // e_u x e_v = e_axis, so u then v winds around +axis
+            int corner = positive ? i : 3 - i;
+            float pos[3], normal[3] = {0.0f, 0.0f, 0.0f};
+            pos[axis] = k * GRID_UNIT;
+            pos[u] = (u0 + corners[corner][0] * quad_width) * GRID_UNIT;
+            pos[v] = (v0 + corners[corner][1] * quad_height) * GRID_UNIT;
+            normal[axis] = positive ? 1.0f : -1.0f;
+            vertices.insert(vertices.end(), pos, pos + 3);
+            vertices.insert(vertices.end(), normal, normal + 3);
+            vertices.insert(vertices.end(), color.data, color.data + 3);
+        }
+    }
+
+    // Indexes the quads chunk by chunk
+    void buildChunks(const std::vector<float>& vertices, std::vector<unsigned int>& indices,
+                     std::vector<TrackMeshChunk>& chunks)
+    {
+        std::sort(quads.begin(), quads.end());
+        const unsigned int quad_indices[6] = {0, 1, 2, 0, 2, 3};
+        for(int i = 0; i < quads.size(); i++)
+        {
+            const ChunkQuad& quad = quads[i];
+            const float* first_pos = &(vertices[quad.first_vertex * FLOATS_PER_VERTEX]);
+            if(i == 0 || quad.chunk_key != quads[i - 1].chunk_key)
+            {
+                TrackMeshChunk chunk;
+                chunk.bounds.min = chunk.bounds.max = Vec3(first_pos[0], first_pos[1], first_pos[2]);
+                chunk.first_index = indices.size();
+                chunk.num_indices = 0;
+                chunks.push_back(chunk);
+            }
+            TrackMeshChunk& chunk = chunks.back();
+            for(int j = 0; j < 4; j++)
+            {
+                const float* pos = first_pos + j * FLOATS_PER_VERTEX;
+                chunk.bounds.enlargeTo(Vec3(pos[0], pos[1], pos[2]));
+            }
+            for(int j = 0; j < 6; j++)
+            {
+                indices.push_back(quad.first_vertex + quad_indices[j]);
+            }
+            chunk.num_indices += 6;
+        }
+    }
+
+    struct CompareLo
+    {
+        CompareLo(const std::vector<BoxCells>& cells, const int axis)
+            :cells(cells), axis(axis)
+        {
+        }
+        bool operator()(const int a, const int b) const
+        {
+            return cells[a].lo[axis] < cells[b].lo[axis];
+        }
+        const std::vector<BoxCells>& cells;
+        int axis;
+    };
+
+    struct CompareHi
+    {
+        CompareHi(const std::vector<BoxCells>& cells, const int axis)
+            :cells(cells), axis(axis)
+        {
+        }
+        bool operator()(const int a, const int b) const
+        {
+            return cells[a].hi[axis] < cells[b].hi[axis];
+        }
+        const std::vector<BoxCells>& cells;
+        int axis;
+    };
+
+    std::vector<BoxCells> cells;
+    std::vector<Vec3> colors;
+    std::vector<ChunkQuad> quads;
+    // Scratch space, kept between builds
+    std::vector<int> by_lo, by_hi, planes, active, starting, ending;
+    std::vector<int> mask;
+    std::vector<TileBox> tile_boxes;
+    std::vector<uint64_t> tiles;
+    TrackMeshStats stats;
+};
+
+/*
+  The track compiled by TrackMesher into static buffers, for play mode where the
+  track doesn't change. update only meshes again when the track's revision moved.
+  submit culls the chunks against the view's frustum and queues one draw per
+  visible chunk.
+ */
+class TrackMesh
+{
+public:
+    TrackMesh()
+        :built_revision(-1)
+    {
+        cull_stats.num_visible = cull_stats.num_culled = 0;
+        shader_program = g_shaders.getProgram("shaders/trackmesh.vs", "shaders/box.fs");
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ibo);
+        g_gl_state.bindVertexArray(vao);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        g_gl_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+        GLsizei stride = sizeof(GLfloat) * TrackMesher::FLOATS_PER_VERTEX; // 3 pos + 3 normal + 3 color
+        const char* attrib_names[3] = {"position", "normal", "color"};
+        for(int i = 0; i < 3; i++)
+        {
+            GLint attrib = g_shaders.getAttrib(shader_program, attrib_names[i]).location;
+            glEnableVertexAttribArray(attrib);
+            glVertexAttribPointer(attrib, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(GLfloat) * 3 * i));
+        }
+        g_gl_state.bindVertexArray(0);
+    }
+
+    TrackMesh(const TrackMesh&) = delete;
+    TrackMesh& operator=(const TrackMesh&) = delete;
+
+    ~TrackMesh()
+    {
+        g_gl_state.deleteVertexArray(vao);
+        g_gl_state.deleteBuffer(vbo);
+        g_gl_state.deleteBuffer(ibo);
+    }
+
+    // Call every play frame, only does work the first frame after the track changed
+    // Returns whether the mesh was built again
+    bool update(const Track& track)
+    {
+        if(track.getRevision() == built_revision)
+        {
+            return false;
+        }
+        built_revision = track.getRevision();
+        mesher.build(track, vertices, indices, chunks);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * vertices.size(), vertices.empty() ? nullptr : &(vertices[0]),
+                     GL_STATIC_DRAW);
+        // The element buffer binding belongs to the vertex array
+        g_gl_state.bindVertexArray(vao);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.empty() ? nullptr : &(indices[0]),
+                     GL_STATIC_DRAW);
+        return true;
+    }
+
+    void printStats() const
+    {
+        mesher.printStats();
+        printf("Track chunks: %d visible, %d culled\n", cull_stats.num_visible, cull_stats.num_culled);
+    }
+
+    // Queue the chunks at least partly inside frustum, front to back
+    void submit(RenderQueue& queue, const Frustum& frustum)
+    {
+        cull_stats.num_visible = 0;
+        for(int i = 0; i < chunks.size(); i++)
+        {
+            const TrackMeshChunk& chunk = chunks[i];
+            if(!frustum.bboxVisible(chunk.bounds))
+            {
+                continue;
+            }
+            cull_stats.num_visible++;
+            float depth = queue.calcDepth((chunk.bounds.min + chunk.bounds.max) * 0.5f);
+            queue.submit(PASS_OPAQUE, shader_program, vao, 0, depth, drawChunk, this,
+                         sizeof(GLuint) * chunk.first_index, chunk.num_indices);
+        }
+        cull_stats.num_culled = chunks.size() - cull_stats.num_visible;
+    }
+
+    // Chunk counts from the last submit
+    CullStats getCullStats() const
+    {
+        return cull_stats;
+    }
+
+private:
+    // data is the byte offset of the chunk's indices
+    static void drawChunk(const DrawItem& item)
+    {
+        g_gl_state.drawElements(GL_TRIANGLES, item.count, GL_UNSIGNED_INT, (const void*)item.data);
+    }
+
+    GLuint vao, vbo, ibo, shader_program;
+    int built_revision;
+    TrackMesher mesher;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TrackMeshChunk> chunks;
+    CullStats cull_stats;
+};
@@ -0,0 +1,334 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <GL/glew.h>
+#include "mat.h"
+#include "track.h"
+#include "frustum.h"
+#include "glstate.h"
+#include "streambuffer.h"
+#include "renderqueue.h"
+#include "shaders/shaderregistry.h"
+
+/*
+  Draws a Track
+  Owns all of the track's GPU resources: the box shader, one unit cube mesh and
+  an instance buffer with the min, max and color of every box. The whole track is
+  one instanced draw, submitted to a RenderQueue. Edited boxes are written to g_stream_buffer and
+  copied into the instance buffer on the GPU over runs of neighbouring indices,
+  only a big change like loading a track uploads everything again.
+  submit culls the boxes against the view's frustum with the track's BVH and draws
+  only the visible ones, compacted into g_stream_buffer.
+  Camera and light come from the FrameUniforms buffer.
+ */
+class TrackRenderer
+{
+public:
+    TrackRenderer()
+        :num_instances(0), instance_capacity(0)
+    {
+        shader_program = g_shaders.getProgram("shaders/box.vs", "shaders/box.fs");
+        glGenVertexArrays(1, &vao);
+        glGenVertexArrays(1, &culled_vao);
+        glGenBuffers(1, &cube_vbo);
+        glGenBuffers(1, &instance_vbo);
+
+        std::vector<GLfloat> cube_vertices;
+        appendUnitCube(cube_vertices);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, cube_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * cube_vertices.size(), &(cube_vertices[0]), GL_STATIC_DRAW);
+        const char* instance_attrib_names[3] = {"instance_min", "instance_max", "instance_color"};
+        for(int i = 0; i < 3; i++)
+        {
+            instance_attribs[i] = g_shaders.getAttrib(shader_program, instance_attrib_names[i]).location;
+        }
+        setAttributes(vao);
+        setInstancePointers(instance_vbo, 0);
+        // culled_vao's instances move around g_stream_buffer, draw points them at each view's data
+        setAttributes(culled_vao);
+        g_gl_state.bindVertexArray(0);
+        cull_stats.num_visible = cull_stats.num_culled = 0;
+    }
+
+    TrackRenderer(const TrackRenderer&) = delete;
+    TrackRenderer& operator=(const TrackRenderer&) = delete;
+
+    ~TrackRenderer()
+    {
+        g_gl_state.deleteVertexArray(vao);
+        g_gl_state.deleteVertexArray(culled_vao);
+        g_gl_state.deleteBuffer(cube_vbo);
+        g_gl_state.deleteBuffer(instance_vbo);
+    }
+
+    // Call once per frame before drawing, even for several views
+    void update(Track& track)
+    {
+        int num_boxes = track.getNumBoxes();
+        if(track.allBoxesChanged() || num_boxes > instance_capacity)
+        {
+            uploadAll(track);
+        }else
+        {
+            uploadChanged(track);
+        }
+        num_instances = num_boxes;
+        track.clearChanges();
+    }
+
+    // Queue the boxes at least partly inside frustum, call update first
+    void submit(RenderQueue& queue, Track& track, const Frustum& frustum)
+    {
+        visible_indices.clear();
+        track.frustumQueryTrack(visible_indices, frustum);
+        int num_visible = visible_indices.size();
+        cull_stats.num_visible = num_visible;
+        cull_stats.num_culled = num_instances - num_visible;
+        if(num_visible == 0)
+        {
+            return;
+        }
+        // The track surrounds the camera, so it goes first among opaque draws with the same state
+        if(num_visible == num_instances)
+        {
+            queue.submit(PASS_OPAQUE, shader_program, vao, 0, 0.0f, drawInstances, this, -1, num_instances);
+            return;
+        }
+        // Keep the instances in track order so the result doesn't depend on the BVH
+        std::sort(visible_indices.begin(), visible_indices.end());
+        GLintptr offset;
+        GLfloat* culled_instances = (GLfloat*)g_stream_buffer.map(sizeof(GLfloat) * FLOATS_PER_INSTANCE * num_visible,
+                                                                  offset);
+        for(int i = 0; i < num_visible; i++)
+        {
+            memcpy(culled_instances + i * FLOATS_PER_INSTANCE,
+                   &(instance_data[visible_indices[i] * FLOATS_PER_INSTANCE]),
+                   sizeof(GLfloat) * FLOATS_PER_INSTANCE);
+        }
+        g_stream_buffer.unmap();
+        queue.submit(PASS_OPAQUE, shader_program, culled_vao, 0, 0.0f, drawInstances, this, offset, num_visible);
+    }
+
+    // Counts from the last culled draw
+    CullStats getCullStats() const
+    {
+        return cull_stats;
+    }
+
+private:
+    static const int FLOATS_PER_INSTANCE = 9;
+    static const int VERTICES_PER_BOX = 36;
+
+    void writeInstance(const int index, const Box& box)
+    {
+        GLfloat* instance = &(instance_data[index * FLOATS_PER_INSTANCE]);
+        Vec3 color = box.getColor();
+        for(int i = 0; i < 3; i++)
+        {
+            instance[i] = box.min[i];
+            instance[i + 3] = box.max[i];
+            instance[i + 6] = color[i];
+        }
+    }
+
+    void uploadAll(const Track& track)
+    {
+        int num_boxes = track.getNumBoxes();
+        instance_data.resize(num_boxes * FLOATS_PER_INSTANCE);
+        for(int i = 0; i < num_boxes; i++)
+        {
+            writeInstance(i, track.getBoxAtIndex(i));
+        }
+        // Leave room to add boxes without reallocating every time
+        if(num_boxes > instance_capacity)
+        {
+            instance_capacity = num_boxes + num_boxes / 2 + 64;
+        }
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * FLOATS_PER_INSTANCE * instance_capacity, nullptr,
+                     GL_DYNAMIC_DRAW);
+        if(num_boxes > 0)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLfloat) * instance_data.size(), &(instance_data[0]));
+        }
+    }
+
+    void uploadChanged(const Track& track)
+    {
+        const std::vector<int>& changed = track.getChangedBoxes();
+        if(changed.empty())
+        {
+            return;
+        }
+        int num_boxes = track.getNumBoxes();
+        instance_data.resize(num_boxes * FLOATS_PER_INSTANCE);
+        dirty_indices.clear();
+        for(int i = 0; i < changed.size(); i++)
+        {
+            // A box removed after it changed no longer exists
+            if(changed[i] < num_boxes)
+            {
+                dirty_indices.push_back(changed[i]);
+            }
+        }
+        std::sort(dirty_indices.begin(), dirty_indices.end());
+        dirty_indices.erase(std::unique(dirty_indices.begin(), dirty_indices.end()), dirty_indices.end());
+        if(dirty_indices.empty())
+        {
+            return;
+        }
+
+        // Stage every changed instance in the ring, then copy each run of consecutive
+        // indices into place on the GPU, which is ordered after earlier draws without
+        // the CPU waiting on them
+        const GLsizeiptr instance_size = sizeof(GLfloat) * FLOATS_PER_INSTANCE;
+        GLintptr staging_offset;
+        GLfloat* staging = (GLfloat*)g_stream_buffer.map(instance_size * dirty_indices.size(), staging_offset);
+        int num_staged = 0;
+        copy_runs.clear();
+        int i = 0;
+        while(i < dirty_indices.size())
+        {
+            int begin = dirty_indices[i];
+            int end = begin;
+            while(i < dirty_indices.size() && dirty_indices[i] == end)
+            {
+                writeInstance(end, track.getBoxAtIndex(end));
+                end++;
+                i++;
+            }
+            memcpy(staging + num_staged * FLOATS_PER_INSTANCE, &(instance_data[begin * FLOATS_PER_INSTANCE]),
+                   instance_size * (end - begin));
+            CopyRun run = {num_staged, begin, end - begin};
+            copy_runs.push_back(run);
+            num_staged += end - begin;
+        }
+        g_stream_buffer.unmap();
+
+        g_gl_state.bindBuffer(GL_COPY_READ_BUFFER, g_stream_buffer.getBuffer());
+        g_gl_state.bindBuffer(GL_COPY_WRITE_BUFFER, instance_vbo);
+        for(int j = 0; j < copy_runs.size(); j++)
+        {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                staging_offset + instance_size * copy_runs[j].staged,
+                                instance_size * copy_runs[j].index, instance_size * copy_runs[j].count);
+        }
+    }
+
+    // item.data is the culled instances' offset in g_stream_buffer, or -1 to draw them all
+    static void drawInstances(const DrawItem& item)
+    {
+        if(item.data != -1)
+        {
+            ((const TrackRenderer*)item.object)->setInstancePointers(g_stream_buffer.getBuffer(), item.data);
+        }
+        g_gl_state.drawArraysInstanced(GL_TRIANGLES, 0, VERTICES_PER_BOX, item.count);
+    }
+
+    // Cube mesh from cube_vbo, leaves vertex_array bound for setInstancePointers
+    void setAttributes(const GLuint vertex_array)
+    {
+        g_gl_state.bindVertexArray(vertex_array);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, cube_vbo);
+        GLsizei stride = sizeof(GLfloat) * 6; // 3 pos + 3 normal
+        GLint pos_attrib = g_shaders.getAttrib(shader_program, "position").location;
+        glEnableVertexAttribArray(pos_attrib);
+        glVertexAttribPointer(pos_attrib, 3, GL_FLOAT, GL_FALSE, stride, 0);
+
+        GLint norm_attrib = g_shaders.getAttrib(shader_program, "normal").location;
+        glEnableVertexAttribArray(norm_attrib);
+        glVertexAttribPointer(norm_attrib, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(sizeof(GLfloat) * 3));
+
+        for(int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(instance_attribs[i]);
+            glVertexAttribDivisor(instance_attribs[i], 1);
+        }
+    }
+
+    // Per instance min, max and color from instance_buffer at offset, for the bound vertex array
+    void setInstancePointers(const GLuint instance_buffer, const GLintptr offset) const
+    {
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+        GLsizei instance_stride = sizeof(GLfloat) * FLOATS_PER_INSTANCE; // 3 min + 3 max + 3 color
+        for(int i = 0; i < 3; i++)
+        {
+            glVertexAttribPointer(instance_attribs[i], 3, GL_FLOAT, GL_FALSE, instance_stride,
+                                  (const void*)(offset + sizeof(GLfloat) * 3 * i));
+        }
+    }
+
+    static void appendVertex(std::vector<GLfloat>& vertices, const Vec3& position, const Vec3& normal)
+    {
+        vertices.insert(vertices.end(), position.data, position.data + 3);
+        vertices.insert(vertices.end(), normal.data, normal.data + 3);
+    }
+
+    // Two triangles per face, a b c and c b d
+    static void appendFace(std::vector<GLfloat>& vertices, const Vec3& a, const Vec3& b, const Vec3& c,
+                           const Vec3& d, const Vec3& normal)
+    {
+        appendVertex(vertices, a, normal);
+        appendVertex(vertices, b, normal);
+        appendVertex(vertices, c, normal);
+        appendVertex(vertices, c, normal);
+        appendVertex(vertices, b, normal);
+        appendVertex(vertices, d, normal);
+    }
+
+    // Cube from (0, 0, 0) to (1, 1, 1), box.vs stretches it from instance_min to instance_max
+    static void appendUnitCube(std::vector<GLfloat>& vertices)
+    {
+        Vec3 min(0.0f, 0.0f, 0.0f);
+        Vec3 max(1.0f, 1.0f, 1.0f);
+
+        Vec3 top_right_forward(max);
+        Vec3 top_right_back(max[0], max[1], min[2]);
+        Vec3 top_left_back(min[0], max[1], min[2]);
+        Vec3 top_left_forward(min[0], max[1], max[2]);
+
+        Vec3 bottom_left_back(min);
+        Vec3 bottom_left_forward(min[0], min[1], max[2]);
+        Vec3 bottom_right_forward(max[0], min[1], max[2]);
+        Vec3 bottom_right_back(max[0], min[1], min[2]);
+
+        // Top
+        appendFace(vertices, top_left_back, top_left_forward, top_right_back, top_right_forward,
+                   Vec3(0.0f, 1.0f, 0.0f));
+        // Bottom
+        appendFace(vertices, bottom_right_back, bottom_right_forward, bottom_left_back, bottom_left_forward,
+                   Vec3(0.0f, -1.0f, 0.0f));
+        // Left
+        appendFace(vertices, bottom_left_forward, top_left_forward, bottom_left_back, top_left_back,
+                   Vec3(-1.0f, 0.0f, 0.0f));
+        // Right
+        appendFace(vertices, bottom_right_back, top_right_back, bottom_right_forward, top_right_forward,
+                   Vec3(1.0f, 0.0f, 0.0f));
+        // Forward
+        appendFace(vertices, bottom_right_forward, bottom_left_forward, top_right_forward, top_left_forward,
+                   Vec3(0.0f, 0.0f, 1.0f));
+        // Back
+        appendFace(vertices, bottom_left_back, bottom_right_back, top_left_back, top_right_back,
+                   Vec3(0.0f, 0.0f, -1.0f));
+    }
+
+    GLuint vao, cube_vbo, instance_vbo;
+    GLuint culled_vao;
+    GLuint shader_program;
+    int num_instances;
+    int instance_capacity;
+    std::vector<GLfloat> instance_data;
+    std::vector<int> dirty_indices;
+    std::vector<int> visible_indices;
+    // A run of changed instances staged in g_stream_buffer
+    struct CopyRun
+    {
+        int staged;
+        int index;
+        int count;
+    };
+    std::vector<CopyRun> copy_runs;
+    GLint instance_attribs[3];
+    CullStats cull_stats;
+};
@@ -6,6 +6,9 @@
 #include "vec.h"
 #include "box.h"
 #include "selected.h"
+#include "glstate.h"
+#include "renderqueue.h"
+#include "shaders/shaderregistry.h"
 /*
   The stick part of the arrow could just be a line
   Cone part of the arrow should be drawn as a triangle fan
@@ -16,7 +19,7 @@
 class Translator
 {
 public:
-    Translator(const Mat4& proj_transform)
+    Translator()
     {
         std::vector<Vec3> cone_verts;
         const float cone_radius = 0.25f;
@@ -54,27 +57,23 @@ public:
         // The first vert on the rim of the cone is counted twice 1 + 36 + 1 = 38
         num_vertices = 38;
         std::vector<float>* float_vec = reinterpret_cast<std::vector<float>*>(&cone_verts);
-        shader_program = loadAndLinkShaders("shaders/model.vs", "shaders/color.fs");
+        shader_program = g_shaders.getProgram("shaders/model.vs", "shaders/color.fs");
+        u_color = g_shaders.getUniform<Vec3>(shader_program, "color");
+        u_model_mat = g_shaders.getUniform<Mat4>(shader_program, "model_mat");
 
-        glUseProgram(shader_program);
         glGenVertexArrays(1, &vao);
         glGenBuffers(1, &vbo);
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        g_gl_state.bindVertexArray(vao);
+        g_gl_state.bindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * (*float_vec).size(), &((*float_vec)[0]), GL_STATIC_DRAW);
 
-        // Uniforms
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-
         // Attributes
         GLsizei stride = sizeof(GLfloat) * 3;
-        GLint pos_attrib = glGetAttribLocation(shader_program, "position");
+        GLint pos_attrib = g_shaders.getAttrib(shader_program, "position").location;
         glEnableVertexAttribArray(pos_attrib);
         glVertexAttribPointer(pos_attrib, 3, GL_FLOAT, GL_FALSE, stride, 0);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
+        g_gl_state.bindVertexArray(0);
 
         // Construct bounding boxes
         // X arrow
@@ -95,35 +94,14 @@ public:
 
     ~Translator()
     {
-        glDeleteBuffers(1, &vao);
-        glDeleteVertexArrays(1, &vao);
-        glDeleteProgram(shader_program);
+        g_gl_state.deleteBuffer(vbo);
+        g_gl_state.deleteVertexArray(vao);
     }
 
-    void draw(const Mat4& view_transform)
+    // Drawn over everything so the arrows can always be grabbed
+    void submit(RenderQueue& queue) const
     {
-        glUseProgram(shader_program);
-        glBindVertexArray(vao);
-        GLint view_handle = glGetUniformLocation(shader_program, "view_mat");
-        glUniformMatrix4fv(view_handle, 1, GL_TRUE, &(view_transform.data[0][0]));
-        GLint model_handle = glGetUniformLocation(shader_program, "model_mat");
-        glUniformMatrix4fv(model_handle, 1, GL_TRUE, &(model_transform.data[0][0]));
-        Vec3 color(0.0f, 0.0f, 1.0f);
-        glUniform3fv(glGetUniformLocation(shader_program, "color"), 1, (const float*)(color.data));
-        // Draw cone
-        glDrawArrays(GL_TRIANGLE_FAN, 0, num_vert_per_cone);
-        // Draw handle
-        glDrawArrays(GL_LINES, num_vert_per_cone, 2);
-        color = Vec3(1.0f, 0.0f, 0.0f);
-        glUniform3fv(glGetUniformLocation(shader_program, "color"), 1, (const float*)(color.data));        
-        glDrawArrays(GL_TRIANGLE_FAN, num_vert_per_arrow, num_vert_per_cone);
-        glDrawArrays(GL_LINES, num_vert_per_arrow + num_vert_per_cone, 2);
-        color = Vec3(0.0f, 1.0f, 0.0f);
-        glUniform3fv(glGetUniformLocation(shader_program, "color"), 1, (const float*)(color.data));        
-        glDrawArrays(GL_TRIANGLE_FAN, 2 * num_vert_per_arrow, num_vert_per_cone);
-        glDrawArrays(GL_LINES, 2 * num_vert_per_arrow + num_vert_per_cone, 2);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        queue.submit(PASS_OVERLAY, shader_program, vao, 0, 0.0f, drawArrows, this);
     }
 
     // Test whether ray hits any of the bounding boxes
@@ -194,15 +172,24 @@ public:
         selected.move(movement_axis * amount);        
     }
 
-    void setProjTransform(const Mat4& proj_transform)
+private:
+    static void drawArrows(const DrawItem& item)
     {
-        glUseProgram(shader_program);
-        GLint proj_handle = glGetUniformLocation(shader_program, "proj_mat");
-        glUniformMatrix4fv(proj_handle, 1, GL_TRUE, &(proj_transform.data[0][0]));
-        glUseProgram(0);
-    }        
+        const Translator& t = *(const Translator*)item.object;
+        setUniform(t.u_model_mat, t.model_transform);
+        setUniform(t.u_color, Vec3(0.0f, 0.0f, 1.0f));
+        // Draw cone
+        g_gl_state.drawArrays(GL_TRIANGLE_FAN, 0, t.num_vert_per_cone);
+        // Draw handle
+        g_gl_state.drawArrays(GL_LINES, t.num_vert_per_cone, 2);
+        setUniform(t.u_color, Vec3(1.0f, 0.0f, 0.0f));
+        g_gl_state.drawArrays(GL_TRIANGLE_FAN, t.num_vert_per_arrow, t.num_vert_per_cone);
+        g_gl_state.drawArrays(GL_LINES, t.num_vert_per_arrow + t.num_vert_per_cone, 2);
+        setUniform(t.u_color, Vec3(0.0f, 1.0f, 0.0f));
+        g_gl_state.drawArrays(GL_TRIANGLE_FAN, 2 * t.num_vert_per_arrow, t.num_vert_per_cone);
+        g_gl_state.drawArrays(GL_LINES, 2 * t.num_vert_per_arrow + t.num_vert_per_cone, 2);
+    }
 
-private:
     void generateCone(std::vector<Vec3>& vertices, const float radius, const float height)
     {
         vertices.push_back(Vec3(0.0f, height, 0.0f));
@@ -221,6 +208,8 @@ private:
     int hit_arrow;
     GLuint vao, vbo;
     GLuint shader_program;
+    Uniform<Vec3> u_color;
+    Uniform<Mat4> u_model_mat;
     static BBox arrow_bboxes_at_origin[3];
 };
 